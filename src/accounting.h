@@ -0,0 +1,132 @@
+/* Copyright (c) 2012, Bastien Dejean
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef BSPWM_ACCOUNTING_H
+#define BSPWM_ACCOUNTING_H
+
+#include <xcb/xcb.h>
+#include <xcb/xcb_aux.h>
+#include <xcb/xcb_ewmh.h>
+#include <xcb/xcb_icccm.h>
+#include <xcb/randr.h>
+#include <xcb/shape.h>
+#include <xcb/xinerama.h>
+#include "stats.h"
+
+/* Shadows the requests sent and the replies waited for by the window manager
+ * so that they are counted, per calling function and per command, along with
+ * the time spent blocked. It must come after every other inclusion: the X
+ * headers are included first so that their declarations aren't expanded. */
+
+#define xcb_allow_events(...)                         (count_request(__func__), xcb_allow_events(__VA_ARGS__))
+#define xcb_change_property(...)                      (count_request(__func__), xcb_change_property(__VA_ARGS__))
+#define xcb_change_save_set(...)                      (count_request(__func__), xcb_change_save_set(__VA_ARGS__))
+#define xcb_change_window_attributes(...)             (count_request(__func__), xcb_change_window_attributes(__VA_ARGS__))
+#define xcb_change_window_attributes_checked(...)     (count_request(__func__), xcb_change_window_attributes_checked(__VA_ARGS__))
+#define xcb_configure_window(...)                     (count_request(__func__), xcb_configure_window(__VA_ARGS__))
+#define xcb_create_window(...)                        (count_request(__func__), xcb_create_window(__VA_ARGS__))
+#define xcb_destroy_window(...)                       (count_request(__func__), xcb_destroy_window(__VA_ARGS__))
+#define xcb_get_geometry(...)                         (count_request(__func__), xcb_get_geometry(__VA_ARGS__))
+#define xcb_get_input_focus(...)                      (count_request(__func__), xcb_get_input_focus(__VA_ARGS__))
+#define xcb_get_modifier_mapping(...)                 (count_request(__func__), xcb_get_modifier_mapping(__VA_ARGS__))
+#define xcb_get_window_attributes(...)                (count_request(__func__), xcb_get_window_attributes(__VA_ARGS__))
+#define xcb_grab_button(...)                          (count_request(__func__), xcb_grab_button(__VA_ARGS__))
+#define xcb_grab_pointer(...)                         (count_request(__func__), xcb_grab_pointer(__VA_ARGS__))
+#define xcb_intern_atom(...)                          (count_request(__func__), xcb_intern_atom(__VA_ARGS__))
+#define xcb_kill_client(...)                          (count_request(__func__), xcb_kill_client(__VA_ARGS__))
+#define xcb_map_window(...)                           (count_request(__func__), xcb_map_window(__VA_ARGS__))
+#define xcb_query_pointer(...)                        (count_request(__func__), xcb_query_pointer(__VA_ARGS__))
+#define xcb_query_tree(...)                           (count_request(__func__), xcb_query_tree(__VA_ARGS__))
+#define xcb_reparent_window(...)                      (count_request(__func__), xcb_reparent_window(__VA_ARGS__))
+#define xcb_send_event(...)                           (count_request(__func__), xcb_send_event(__VA_ARGS__))
+#define xcb_set_input_focus(...)                      (count_request(__func__), xcb_set_input_focus(__VA_ARGS__))
+#define xcb_ungrab_button(...)                        (count_request(__func__), xcb_ungrab_button(__VA_ARGS__))
+#define xcb_ungrab_pointer(...)                       (count_request(__func__), xcb_ungrab_pointer(__VA_ARGS__))
+#define xcb_unmap_window(...)                         (count_request(__func__), xcb_unmap_window(__VA_ARGS__))
+#define xcb_warp_pointer(...)                         (count_request(__func__), xcb_warp_pointer(__VA_ARGS__))
+#define xcb_ewmh_get_wm_desktop(...)                  (count_request(__func__), xcb_ewmh_get_wm_desktop(__VA_ARGS__))
+#define xcb_ewmh_get_wm_state(...)                    (count_request(__func__), xcb_ewmh_get_wm_state(__VA_ARGS__))
+#define xcb_ewmh_get_wm_strut_partial(...)            (count_request(__func__), xcb_ewmh_get_wm_strut_partial(__VA_ARGS__))
+#define xcb_ewmh_get_wm_window_type(...)              (count_request(__func__), xcb_ewmh_get_wm_window_type(__VA_ARGS__))
+#define xcb_ewmh_set_active_window(...)               (count_request(__func__), xcb_ewmh_set_active_window(__VA_ARGS__))
+#define xcb_ewmh_set_client_list(...)                 (count_request(__func__), xcb_ewmh_set_client_list(__VA_ARGS__))
+#define xcb_ewmh_set_client_list_stacking(...)        (count_request(__func__), xcb_ewmh_set_client_list_stacking(__VA_ARGS__))
+#define xcb_ewmh_set_current_desktop(...)             (count_request(__func__), xcb_ewmh_set_current_desktop(__VA_ARGS__))
+#define xcb_ewmh_set_desktop_names(...)               (count_request(__func__), xcb_ewmh_set_desktop_names(__VA_ARGS__))
+#define xcb_ewmh_set_desktop_viewport(...)            (count_request(__func__), xcb_ewmh_set_desktop_viewport(__VA_ARGS__))
+#define xcb_ewmh_set_number_of_desktops(...)          (count_request(__func__), xcb_ewmh_set_number_of_desktops(__VA_ARGS__))
+#define xcb_ewmh_set_supported(...)                   (count_request(__func__), xcb_ewmh_set_supported(__VA_ARGS__))
+#define xcb_ewmh_set_supporting_wm_check(...)         (count_request(__func__), xcb_ewmh_set_supporting_wm_check(__VA_ARGS__))
+#define xcb_ewmh_set_wm_desktop(...)                  (count_request(__func__), xcb_ewmh_set_wm_desktop(__VA_ARGS__))
+#define xcb_ewmh_set_wm_name(...)                     (count_request(__func__), xcb_ewmh_set_wm_name(__VA_ARGS__))
+#define xcb_ewmh_set_wm_pid(...)                      (count_request(__func__), xcb_ewmh_set_wm_pid(__VA_ARGS__))
+#define xcb_ewmh_set_wm_state(...)                    (count_request(__func__), xcb_ewmh_set_wm_state(__VA_ARGS__))
+#define xcb_icccm_get_wm_class(...)                   (count_request(__func__), xcb_icccm_get_wm_class(__VA_ARGS__))
+#define xcb_icccm_get_wm_hints(...)                   (count_request(__func__), xcb_icccm_get_wm_hints(__VA_ARGS__))
+#define xcb_icccm_get_wm_name(...)                    (count_request(__func__), xcb_icccm_get_wm_name(__VA_ARGS__))
+#define xcb_icccm_get_wm_normal_hints(...)            (count_request(__func__), xcb_icccm_get_wm_normal_hints(__VA_ARGS__))
+#define xcb_icccm_get_wm_protocols(...)               (count_request(__func__), xcb_icccm_get_wm_protocols(__VA_ARGS__))
+#define xcb_icccm_get_wm_transient_for(...)           (count_request(__func__), xcb_icccm_get_wm_transient_for(__VA_ARGS__))
+#define xcb_icccm_set_wm_class(...)                   (count_request(__func__), xcb_icccm_set_wm_class(__VA_ARGS__))
+#define xcb_icccm_set_wm_name(...)                    (count_request(__func__), xcb_icccm_set_wm_name(__VA_ARGS__))
+#define xcb_randr_get_crtc_info(...)                  (count_request(__func__), xcb_randr_get_crtc_info(__VA_ARGS__))
+#define xcb_randr_get_output_info(...)                (count_request(__func__), xcb_randr_get_output_info(__VA_ARGS__))
+#define xcb_randr_get_output_primary(...)             (count_request(__func__), xcb_randr_get_output_primary(__VA_ARGS__))
+#define xcb_randr_get_screen_resources(...)           (count_request(__func__), xcb_randr_get_screen_resources(__VA_ARGS__))
+#define xcb_randr_select_input(...)                   (count_request(__func__), xcb_randr_select_input(__VA_ARGS__))
+#define xcb_xinerama_is_active(...)                   (count_request(__func__), xcb_xinerama_is_active(__VA_ARGS__))
+#define xcb_xinerama_query_screens(...)               (count_request(__func__), xcb_xinerama_query_screens(__VA_ARGS__))
+#define xcb_shape_rectangles(...)                     (count_request(__func__), xcb_shape_rectangles(__VA_ARGS__))
+
+#define xcb_get_geometry_reply(...)                   ((xcb_get_geometry_reply_t *) end_wait_reply(__func__, (begin_wait(), xcb_get_geometry_reply(__VA_ARGS__))))
+#define xcb_get_input_focus_reply(...)                ((xcb_get_input_focus_reply_t *) end_wait_reply(__func__, (begin_wait(), xcb_get_input_focus_reply(__VA_ARGS__))))
+#define xcb_get_modifier_mapping_reply(...)           ((xcb_get_modifier_mapping_reply_t *) end_wait_reply(__func__, (begin_wait(), xcb_get_modifier_mapping_reply(__VA_ARGS__))))
+#define xcb_get_window_attributes_reply(...)          ((xcb_get_window_attributes_reply_t *) end_wait_reply(__func__, (begin_wait(), xcb_get_window_attributes_reply(__VA_ARGS__))))
+#define xcb_grab_pointer_reply(...)                   ((xcb_grab_pointer_reply_t *) end_wait_reply(__func__, (begin_wait(), xcb_grab_pointer_reply(__VA_ARGS__))))
+#define xcb_intern_atom_reply(...)                    ((xcb_intern_atom_reply_t *) end_wait_reply(__func__, (begin_wait(), xcb_intern_atom_reply(__VA_ARGS__))))
+#define xcb_query_pointer_reply(...)                  ((xcb_query_pointer_reply_t *) end_wait_reply(__func__, (begin_wait(), xcb_query_pointer_reply(__VA_ARGS__))))
+#define xcb_query_tree_reply(...)                     ((xcb_query_tree_reply_t *) end_wait_reply(__func__, (begin_wait(), xcb_query_tree_reply(__VA_ARGS__))))
+#define xcb_randr_get_crtc_info_reply(...)            ((xcb_randr_get_crtc_info_reply_t *) end_wait_reply(__func__, (begin_wait(), xcb_randr_get_crtc_info_reply(__VA_ARGS__))))
+#define xcb_randr_get_output_info_reply(...)          ((xcb_randr_get_output_info_reply_t *) end_wait_reply(__func__, (begin_wait(), xcb_randr_get_output_info_reply(__VA_ARGS__))))
+#define xcb_randr_get_output_primary_reply(...)       ((xcb_randr_get_output_primary_reply_t *) end_wait_reply(__func__, (begin_wait(), xcb_randr_get_output_primary_reply(__VA_ARGS__))))
+#define xcb_randr_get_screen_resources_reply(...)     ((xcb_randr_get_screen_resources_reply_t *) end_wait_reply(__func__, (begin_wait(), xcb_randr_get_screen_resources_reply(__VA_ARGS__))))
+#define xcb_xinerama_is_active_reply(...)             ((xcb_xinerama_is_active_reply_t *) end_wait_reply(__func__, (begin_wait(), xcb_xinerama_is_active_reply(__VA_ARGS__))))
+#define xcb_xinerama_query_screens_reply(...)         ((xcb_xinerama_query_screens_reply_t *) end_wait_reply(__func__, (begin_wait(), xcb_xinerama_query_screens_reply(__VA_ARGS__))))
+#define xcb_request_check(...)                        ((xcb_generic_error_t *) end_wait_reply(__func__, (begin_wait(), xcb_request_check(__VA_ARGS__))))
+
+#define xcb_icccm_get_wm_class_reply(...)             end_wait_status(__func__, (begin_wait(), xcb_icccm_get_wm_class_reply(__VA_ARGS__)))
+#define xcb_icccm_get_wm_hints_reply(...)             end_wait_status(__func__, (begin_wait(), xcb_icccm_get_wm_hints_reply(__VA_ARGS__)))
+#define xcb_icccm_get_wm_name_reply(...)              end_wait_status(__func__, (begin_wait(), xcb_icccm_get_wm_name_reply(__VA_ARGS__)))
+#define xcb_icccm_get_wm_normal_hints_reply(...)      end_wait_status(__func__, (begin_wait(), xcb_icccm_get_wm_normal_hints_reply(__VA_ARGS__)))
+#define xcb_icccm_get_wm_protocols_reply(...)         end_wait_status(__func__, (begin_wait(), xcb_icccm_get_wm_protocols_reply(__VA_ARGS__)))
+#define xcb_icccm_get_wm_transient_for_reply(...)     end_wait_status(__func__, (begin_wait(), xcb_icccm_get_wm_transient_for_reply(__VA_ARGS__)))
+#define xcb_ewmh_get_wm_desktop_reply(...)            end_wait_status(__func__, (begin_wait(), xcb_ewmh_get_wm_desktop_reply(__VA_ARGS__)))
+#define xcb_ewmh_get_wm_state_reply(...)              end_wait_status(__func__, (begin_wait(), xcb_ewmh_get_wm_state_reply(__VA_ARGS__)))
+#define xcb_ewmh_get_wm_strut_partial_reply(...)      end_wait_status(__func__, (begin_wait(), xcb_ewmh_get_wm_strut_partial_reply(__VA_ARGS__)))
+#define xcb_ewmh_get_wm_window_type_reply(...)        end_wait_status(__func__, (begin_wait(), xcb_ewmh_get_wm_window_type_reply(__VA_ARGS__)))
+
+#define xcb_aux_sync(...)                             (count_request(__func__), begin_wait(), xcb_aux_sync(__VA_ARGS__), end_wait(__func__))
+
+#endif
@@ -33,6 +33,7 @@
 #include <unistd.h>
 #include "helpers.h"
 #include "common.h"
+#include "mirror.h"
 
 int main(int argc, char *argv[])
 {
@@ -64,6 +65,40 @@ int main(int argc, char *argv[])
 		return EXIT_SUCCESS;
 	}
 
+	if (streq(argv[1], "query")) {
+		bool use_mirror = false;
+		for (int i = 2; i < argc; i++) {
+			if (streq(argv[i], "--shm")) {
+				use_mirror = true;
+				memmove(argv + i, argv + i + 1, (argc - i) * sizeof(char *));
+				argc--, i--;
+			}
+		}
+		if (use_mirror) {
+			char mirror_path[MAXLEN] = {0};
+			char *mp = getenv(MIRROR_ENV_VAR);
+			if (mp != NULL) {
+				snprintf(mirror_path, sizeof(mirror_path), "%s", mp);
+			} else {
+				char *host = NULL;
+				int dn = 0, sn = 0;
+				if (xcb_parse_display(NULL, &host, &dn, &sn) != 0) {
+					snprintf(mirror_path, sizeof(mirror_path), MIRROR_PATH_TPL, host, dn, sn);
+				}
+				free(host);
+			}
+			mirror_t mr;
+			if (mirror_open(&mr, mirror_path)) {
+				const mirror_header_t *h = mirror_read(&mr);
+				bool answered = h != NULL && mirror_query(h, argc - 2, argv + 2, stdout);
+				mirror_close(&mr);
+				if (answered) {
+					return EXIT_SUCCESS;
+				}
+			}
+		}
+	}
+
 	if ((sock_fd = socket(AF_UNIX, SOCK_STREAM, 0)) == -1) {
 		err("Failed to create the socket.\n");
 	}
@@ -51,7 +51,13 @@
 #include "rule.h"
 #include "restore.h"
 #include "query.h"
+#include "snapshot.h"
+#include "publish.h"
+#include "record.h"
+#include "subscribe.h"
+#include "trace.h"
 #include "bspwm.h"
+#include "accounting.h"
 
 xcb_connection_t *dpy;
 int default_screen, screen_width, screen_height;
@@ -69,12 +75,14 @@ history_t *history_tail;
 history_t *history_needle;
 rule_t *rule_head;
 rule_t *rule_tail;
+rule_index_t rule_index;
 stacking_list_t *stack_head;
 stacking_list_t *stack_tail;
 subscriber_list_t *subscribe_head;
 subscriber_list_t *subscribe_tail;
 pending_rule_t *pending_rule_head;
 pending_rule_t *pending_rule_tail;
+rules_daemon_t rules_daemon;
 
 xcb_window_t meta_window;
 motion_recorder_t motion_recorder;
@@ -87,6 +95,7 @@ bool auto_raise;
 bool sticky_still;
 bool hide_sticky;
 bool record_history;
+bool batch_updates;
 bool running;
 bool restart;
 bool randr;
@@ -96,6 +105,7 @@ int main(int argc, char *argv[])
 	fd_set descriptors;
 	char socket_path[MAXLEN];
 	char state_path[MAXLEN] = {0};
+	char *record_path = NULL, *replay_path = NULL;
 	int run_level = 0;
 	config_path[0] = '\0';
 	int sock_fd = -1, cli_fd, dpy_fd, max_fd, n;
@@ -105,16 +115,20 @@ int main(int argc, char *argv[])
 	char *end;
 	int opt;
 
-	while ((opt = getopt(argc, argv, "hvc:s:o:")) != -1) {
+	while ((opt = getopt(argc, argv, "hvj:c:s:o:r:p:")) != -1) {
 		switch (opt) {
 			case 'h':
-				printf(WM_NAME " [-h|-v|-c CONFIG_PATH]\n");
+				printf(WM_NAME " [-h|-v|-j SNAPSHOT_PATH|-c CONFIG_PATH|-r RECORDING_PATH|-p RECORDING_PATH]\n");
 				exit(EXIT_SUCCESS);
 				break;
 			case 'v':
 				printf("%s\n", VERSION);
 				exit(EXIT_SUCCESS);
 				break;
+			case 'j':
+				init();
+				exit(print_snapshot(optarg, stdout) ? EXIT_SUCCESS : EXIT_FAILURE);
+				break;
 			case 'c':
 				snprintf(config_path, sizeof(config_path), "%s", optarg);
 				break;
@@ -129,6 +143,16 @@ int main(int argc, char *argv[])
 					sock_fd = -1;
 				}
 				break;
+			case 'r':
+				record_path = optarg;
+				break;
+			case 'p':
+#ifdef REPLAY
+				replay_path = optarg;
+#else
+				err("Recordings can only be replayed by bspwm-replay.\n");
+#endif
+				break;
 		}
 	}
 
@@ -151,10 +175,25 @@ int main(int argc, char *argv[])
 	setup();
 
 	if (state_path[0] != '\0') {
-		restore_state(state_path);
+		if (!restore_state(state_path)) {
+			warn("Couldn't restore the state from '%s'.\n", state_path);
+		}
 		unlink(state_path);
 	}
 
+	if (replay_path != NULL) {
+		replay_summary_t summary = {0, 0, 0, 0, 0};
+		exit_status = replay(replay_path, &summary) ? EXIT_SUCCESS : EXIT_FAILURE;
+		print_replay_summary(&summary, stdout);
+		cleanup();
+		xcb_disconnect(dpy);
+		return exit_status;
+	}
+
+	if (record_path != NULL) {
+		record_start(record_path);
+	}
+
 	dpy_fd = xcb_get_file_descriptor(dpy);
 
 	if (sock_fd == -1) {
@@ -204,6 +243,8 @@ int main(int argc, char *argv[])
 
 	while (running) {
 
+		poll_motion_recorder();
+		ewmh_flush();
 		xcb_flush(dpy);
 
 		FD_ZERO(&descriptors);
@@ -212,28 +253,63 @@ int main(int argc, char *argv[])
 		max_fd = MAX(sock_fd, dpy_fd);
 
 		for (pending_rule_t *pr = pending_rule_head; pr != NULL; pr = pr->next) {
+			if (pr->fd == -1) {
+				continue;
+			}
 			FD_SET(pr->fd, &descriptors);
 			if (pr->fd > max_fd) {
 				max_fd = pr->fd;
 			}
 		}
 
-		if (select(max_fd + 1, &descriptors, NULL, NULL, NULL) > 0) {
+		if (rules_daemon.out_fd != -1) {
+			FD_SET(rules_daemon.out_fd, &descriptors);
+			max_fd = MAX(max_fd, rules_daemon.out_fd);
+		}
+
+		struct timeval timeout, *tvp = NULL;
+		uint64_t deadline = subscribers_deadline();
+		uint64_t rules_deadline = pending_rules_deadline();
+		uint64_t motion_deadline = drag_deadline();
+
+		if (rules_deadline > 0 && (deadline == 0 || rules_deadline < deadline)) {
+			deadline = rules_deadline;
+		}
+
+		if (motion_deadline > 0 && (deadline == 0 || motion_deadline < deadline)) {
+			deadline = motion_deadline;
+		}
+
+		if (monitors_update_deadline > 0 && (deadline == 0 || monitors_update_deadline < deadline)) {
+			deadline = monitors_update_deadline;
+		}
+
+		if (deadline > 0) {
+			uint64_t now = get_time_ns();
+			uint64_t delay = deadline > now ? deadline - now : 0;
+			timeout.tv_sec = delay / 1000000000;
+			timeout.tv_usec = (delay % 1000000000) / 1000;
+			tvp = &timeout;
+		}
+
+		int ready = select(max_fd + 1, &descriptors, NULL, NULL, tvp);
+		uint64_t iteration = trace_begin();
+
+		if (ready > 0) {
 
 			pending_rule_t *pr = pending_rule_head;
 			while (pr != NULL) {
 				pending_rule_t *next = pr->next;
-				if (FD_ISSET(pr->fd, &descriptors)) {
-					if (manage_window(pr->win, pr->csq, pr->fd)) {
-						for (event_queue_t *eq = pr->event_head; eq != NULL; eq = eq->next) {
-							handle_event(&eq->event);
-						}
-					}
-					remove_pending_rule(pr);
+				if (pr->fd != -1 && FD_ISSET(pr->fd, &descriptors) && read_pending_rule(pr)) {
+					finish_pending_rule(pr);
 				}
 				pr = next;
 			}
 
+			if (rules_daemon.out_fd != -1 && FD_ISSET(rules_daemon.out_fd, &descriptors)) {
+				handle_rules_daemon();
+			}
+
 			if (FD_ISSET(sock_fd, &descriptors)) {
 				cli_fd = accept(sock_fd, NULL, 0);
 				if (cli_fd > 0 && (n = recv(cli_fd, msg, sizeof(msg)-1, 0)) > 0) {
@@ -258,13 +334,29 @@ int main(int argc, char *argv[])
 
 		}
 
+		expire_pending_rules();
+		update_drag();
+		flush_monitors_update();
+
 		if (!check_connection(dpy)) {
 			running = false;
 		}
 
+		flush_subscribers(false);
 		prune_dead_subscribers();
+
+		if (state_mirror) {
+			publish_state();
+		}
+
+		trace_end("main_loop", NULL, iteration);
 	}
 
+	trace_stop();
+	record_stop();
+
+	flush_subscribers(true);
+
 	if (restart) {
 		char *host = NULL;
 		int dn = 0, sn = 0;
@@ -272,16 +364,28 @@ int main(int argc, char *argv[])
 			snprintf(state_path, sizeof(state_path), STATE_PATH_TPL, host, dn, sn);
 		}
 		free(host);
-		FILE *f = fopen(state_path, "w");
-		query_state(f);
-		fclose(f);
+		if (!save_snapshot(state_path)) {
+			FILE *f = fopen(state_path, "w");
+			query_state(f);
+			fclose(f);
+		}
+	}
+
+	if (desktop_containers) {
+		desktop_containers = false;
+		update_desktop_containers();
 	}
 
 	cleanup();
+	ewmh_flush();
+	publish_cleanup(!restart);
 	ungrab_buttons();
 	xcb_ewmh_connection_wipe(ewmh);
 	xcb_destroy_window(dpy, meta_window);
 	xcb_destroy_window(dpy, motion_recorder.id);
+	if (drag_outline != XCB_NONE) {
+		xcb_destroy_window(dpy, drag_outline);
+	}
 	free(ewmh);
 	xcb_flush(dpy);
 	xcb_disconnect(dpy);
@@ -330,13 +434,15 @@ void init(void)
 	mon = mon_head = mon_tail = pri_mon = NULL;
 	history_head = history_tail = history_needle = NULL;
 	rule_head = rule_tail = NULL;
+	rule_index = (rule_index_t) {NULL, 0, 0, 0};
 	stack_head = stack_tail = NULL;
 	subscribe_head = subscribe_tail = NULL;
 	pending_rule_head = pending_rule_tail = NULL;
+	rules_daemon = (rules_daemon_t) {.pid = -1, .in_fd = -1, .out_fd = -1};
 	auto_raise = sticky_still = hide_sticky = record_history = true;
 	randr_base = 0;
 	exit_status = 0;
-	restart = false;
+	batch_updates = restart = false;
 }
 
 void setup(void)
@@ -362,8 +468,10 @@ void setup(void)
 	xcb_icccm_set_wm_class(dpy, meta_window, sizeof(META_WINDOW_IC), META_WINDOW_IC);
 
 	motion_recorder.id = xcb_generate_id(dpy);
+	motion_recorder.parent = root;
 	motion_recorder.sequence = 0;
 	motion_recorder.enabled = false;
+	motion_recorder.query.sequence = 0;
 	uint32_t values[] = {XCB_EVENT_MASK_STRUCTURE_NOTIFY | XCB_EVENT_MASK_POINTER_MOTION};
 	xcb_create_window(dpy, XCB_COPY_FROM_PARENT, motion_recorder.id, root, 0, 0, 1, 1, 0,
 	                  XCB_WINDOW_CLASS_INPUT_ONLY, XCB_COPY_FROM_PARENT, XCB_CW_EVENT_MASK, values);
@@ -484,6 +592,7 @@ void cleanup(void)
 	while (pending_rule_head != NULL) {
 		remove_pending_rule(pending_rule_head);
 	}
+	stop_rules_daemon();
 
 	empty_history();
 }
@@ -35,6 +35,7 @@
 #define STATE_PATH_TPL           "/tmp/bspwm%s_%i_%i-state"
 
 #define ROOT_EVENT_MASK     (XCB_EVENT_MASK_SUBSTRUCTURE_REDIRECT | XCB_EVENT_MASK_SUBSTRUCTURE_NOTIFY | XCB_EVENT_MASK_STRUCTURE_NOTIFY | XCB_EVENT_MASK_BUTTON_PRESS | XCB_EVENT_MASK_FOCUS_CHANGE)
+#define CONTAINER_EVENT_MASK (XCB_EVENT_MASK_SUBSTRUCTURE_REDIRECT | XCB_EVENT_MASK_SUBSTRUCTURE_NOTIFY | XCB_EVENT_MASK_ENTER_WINDOW)
 #define CLIENT_EVENT_MASK   (XCB_EVENT_MASK_PROPERTY_CHANGE | XCB_EVENT_MASK_FOCUS_CHANGE)
 #define BSPWM_CLASS_NAME    "Bspwm"
 #define META_WINDOW_IC      "wm\0" BSPWM_CLASS_NAME
@@ -43,11 +44,17 @@
 #define PRESEL_FEEDBACK_IC  PRESEL_FEEDBACK_I "\0" BSPWM_CLASS_NAME
 #define MOTION_RECORDER_I   "motion_recorder"
 #define MOTION_RECORDER_IC  MOTION_RECORDER_I "\0" BSPWM_CLASS_NAME
+#define DRAG_OUTLINE_I      "drag_outline"
+#define DRAG_OUTLINE_IC     DRAG_OUTLINE_I "\0" BSPWM_CLASS_NAME
+#define CONTAINER_I         "desktop_container"
+#define CONTAINER_IC        CONTAINER_I "\0" BSPWM_CLASS_NAME
 
 typedef struct {
 	xcb_window_t id;
+	xcb_window_t parent;
 	uint16_t sequence;
 	bool enabled;
+	xcb_query_pointer_cookie_t query;
 } motion_recorder_t;
 
 extern xcb_connection_t *dpy;
@@ -66,12 +73,14 @@ extern history_t *history_tail;
 extern history_t *history_needle;
 extern rule_t *rule_head;
 extern rule_t *rule_tail;
+extern rule_index_t rule_index;
 extern stacking_list_t *stack_head;
 extern stacking_list_t *stack_tail;
 extern subscriber_list_t *subscribe_head;
 extern subscriber_list_t *subscribe_tail;
 extern pending_rule_t *pending_rule_head;
 extern pending_rule_t *pending_rule_tail;
+extern rules_daemon_t rules_daemon;
 
 extern xcb_window_t meta_window;
 extern motion_recorder_t motion_recorder;
@@ -84,6 +93,7 @@ extern bool auto_raise;
 extern bool sticky_still;
 extern bool hide_sticky;
 extern bool record_history;
+extern bool batch_updates;
 extern bool running;
 extern bool restart;
 extern bool randr;
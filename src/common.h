@@ -28,6 +28,9 @@
 #define SOCKET_PATH_TPL  "/tmp/bspwm%s_%i_%i-socket"
 #define SOCKET_ENV_VAR   "BSPWM_SOCKET"
 
+#define MIRROR_PATH_TPL  "/bspwm%s_%i_%i-mirror"
+#define MIRROR_ENV_VAR   "BSPWM_MIRROR"
+
 #define FAILURE_MESSAGE  "\x07"
 
 #endif
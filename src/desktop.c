@@ -25,6 +25,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <xcb/shape.h>
 #include "bspwm.h"
 #include "ewmh.h"
 #include "history.h"
@@ -35,6 +36,8 @@
 #include "desktop.h"
 #include "subscribe.h"
 #include "settings.h"
+#include "stack.h"
+#include "accounting.h"
 
 bool activate_desktop(monitor_t *m, desktop_t *d)
 {
@@ -60,7 +63,7 @@ bool activate_desktop(monitor_t *m, desktop_t *d)
 		transfer_sticky_nodes(m, m->desk, m, d, m->desk->root);
 	}
 
-	show_desktop(d);
+	show_desktop(m, d);
 	hide_desktop(m->desk);
 
 	m->desk = d;
@@ -154,7 +157,7 @@ bool set_layout(monitor_t *m, desktop_t *d, layout_t l, bool user)
 
 void handle_presel_feedbacks(monitor_t *m, desktop_t *d)
 {
-	if (m->desk != d) {
+	if (m->desk != d && d->container == XCB_NONE) {
 		return;
 	}
 	if (d->layout == LAYOUT_MONOCLE) {
@@ -214,6 +217,7 @@ bool transfer_desktop(monitor_t *ms, monitor_t *md, desktop_t *d, bool follow)
 
 	adapt_geometry(&ms->rectangle, &md->rectangle, d->root);
 	arrange(md, d);
+	update_desktop_container(d);
 
 	if ((!follow || !d_was_active || !ms_was_focused) && md->desk == d) {
 		if (md == mon) {
@@ -340,6 +344,7 @@ void remove_desktop(monitor_t *m, desktop_t *d)
 	remove_node(m, d, d->root);
 	unlink_desktop(m, d);
 	history_remove(d, NULL, false);
+	destroy_desktop_container(d);
 	free(d);
 
 	ewmh_update_current_desktop();
@@ -464,17 +469,21 @@ bool swap_desktops(monitor_t *m1, desktop_t *d1, monitor_t *m2, desktop_t *d2, b
 		history_remove(d2, NULL, false);
 		arrange(m1, d2);
 		arrange(m2, d1);
+		update_desktop_container(d1);
+		update_desktop_container(d2);
 	}
 
 	if (d1_stickies != NULL) {
 		transfer_sticky_nodes(m1, d1_stickies, m1, d2, d1_stickies->root);
 		unlink_desktop(m1, d1_stickies);
+		destroy_desktop_container(d1_stickies);
 		free(d1_stickies);
 	}
 
 	if (d2_stickies != NULL) {
 		transfer_sticky_nodes(m2, d2_stickies, m2, d1, d2_stickies->root);
 		unlink_desktop(m2, d2_stickies);
+		destroy_desktop_container(d2_stickies);
 		free(d2_stickies);
 	}
 
@@ -482,9 +491,9 @@ bool swap_desktops(monitor_t *m1, desktop_t *d1, monitor_t *m2, desktop_t *d2, b
 		if ((!follow && m1 != m2) || !d1_was_focused) {
 			hide_desktop(d1);
 		}
-		show_desktop(d2);
+		show_desktop(m1, d2);
 	} else if (!d1_was_active && d2_was_active) {
-		show_desktop(d1);
+		show_desktop(m2, d1);
 		if ((!follow && m1 != m2) || !d2_was_focused) {
 			hide_desktop(d2);
 		}
@@ -526,12 +535,20 @@ bool swap_desktops(monitor_t *m1, desktop_t *d1, monitor_t *m2, desktop_t *d2, b
 	return true;
 }
 
-void show_desktop(desktop_t *d)
+void show_desktop(monitor_t *m, desktop_t *d)
 {
 	if (d == NULL) {
 		return;
 	}
+	if (d->stale) {
+		arrange(m, d);
+	}
+	if (d->container != XCB_NONE) {
+		update_desktop_container(d);
+		window_show(d->container);
+	}
 	show_node(d, d->root);
+	restack_presel_feedbacks(d);
 }
 
 void hide_desktop(desktop_t *d)
@@ -539,9 +556,109 @@ void hide_desktop(desktop_t *d)
 	if (d == NULL) {
 		return;
 	}
+	if (d->container != XCB_NONE) {
+		window_hide(d->container);
+	}
 	hide_node(d, d->root);
 }
 
+void create_desktop_container(desktop_t *d)
+{
+	if (d->container != XCB_NONE || !desktop_containers) {
+		return;
+	}
+
+	d->container = xcb_generate_id(dpy);
+	uint32_t mask = XCB_CW_BACK_PIXMAP | XCB_CW_OVERRIDE_REDIRECT | XCB_CW_EVENT_MASK;
+	uint32_t values[] = {XCB_BACK_PIXMAP_PARENT_RELATIVE, 1, CONTAINER_EVENT_MASK};
+	xcb_create_window(dpy, XCB_COPY_FROM_PARENT, d->container, root, 0, 0, INT16_MAX, INT16_MAX, 0,
+	                  XCB_WINDOW_CLASS_INPUT_OUTPUT, XCB_COPY_FROM_PARENT, mask, values);
+	xcb_icccm_set_wm_class(dpy, d->container, sizeof(CONTAINER_IC), CONTAINER_IC);
+
+	for (monitor_t *m = mon_head; m != NULL; m = m->next) {
+		if (m->desk == d) {
+			update_desktop_container(d);
+			window_show(d->container);
+			break;
+		}
+	}
+}
+
+void update_desktop_container(desktop_t *d)
+{
+	if (d->container == XCB_NONE) {
+		return;
+	}
+	for (monitor_t *m = mon_head; m != NULL; m = m->next) {
+		for (desktop_t *e = m->desk_head; e != NULL; e = e->next) {
+			if (e != d) {
+				continue;
+			}
+			/* Clip the container to its monitor */
+			xcb_shape_rectangles(dpy, XCB_SHAPE_SO_SET, XCB_SHAPE_SK_BOUNDING, XCB_CLIP_ORDERING_UNSORTED,
+			                     d->container, 0, 0, 1, &m->rectangle);
+			if (m->root != XCB_NONE) {
+				window_above(d->container, m->root);
+			} else {
+				window_lower(d->container);
+			}
+			return;
+		}
+	}
+}
+
+void destroy_desktop_container(desktop_t *d)
+{
+	if (d->container == XCB_NONE) {
+		return;
+	}
+
+	reparent_node(NULL, d->root);
+
+	/* Rescue any window that isn't part of the tree anymore */
+	xcb_query_tree_reply_t *qtr = xcb_query_tree_reply(dpy, xcb_query_tree(dpy, d->container), NULL);
+	if (qtr != NULL) {
+		xcb_window_t *wins = xcb_query_tree_children(qtr);
+		int len = xcb_query_tree_children_length(qtr);
+		for (int i = 0; i < len; i++) {
+			xcb_get_geometry_reply_t *geo = xcb_get_geometry_reply(dpy, xcb_get_geometry(dpy, wins[i]), NULL);
+			if (geo != NULL) {
+				window_reparent(wins[i], d->container, root, geo->x, geo->y);
+				free(geo);
+			}
+		}
+		free(qtr);
+	}
+
+	if (motion_recorder.parent == d->container) {
+		xcb_reparent_window(dpy, motion_recorder.id, root, 0, 0);
+		motion_recorder.parent = root;
+	}
+
+	xcb_destroy_window(dpy, d->container);
+	d->container = XCB_NONE;
+}
+
+void update_desktop_containers(void)
+{
+	for (monitor_t *m = mon_head; m != NULL; m = m->next) {
+		for (desktop_t *d = m->desk_head; d != NULL; d = d->next) {
+			if (desktop_containers) {
+				reparent_node(d, d->root);
+			} else if (d->container != XCB_NONE) {
+				destroy_desktop_container(d);
+				if (m->desk == d) {
+					show_node(d, d->root);
+				}
+			}
+		}
+	}
+	restack_windows();
+	for (monitor_t *m = mon_head; m != NULL; m = m->next) {
+		restack_presel_feedbacks(m->desk);
+	}
+}
+
 bool is_urgent(desktop_t *d)
 {
 	for (node_t *n = first_extrema(d->root); n != NULL; n = next_leaf(n, d->root)) {
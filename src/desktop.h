@@ -42,8 +42,12 @@ void unlink_desktop(monitor_t *m, desktop_t *d);
 void remove_desktop(monitor_t *m, desktop_t *d);
 void merge_desktops(monitor_t *ms, desktop_t *ds, monitor_t *md, desktop_t *dd);
 bool swap_desktops(monitor_t *m1, desktop_t *d1, monitor_t *m2, desktop_t *d2, bool follow);
-void show_desktop(desktop_t *d);
+void show_desktop(monitor_t *m, desktop_t *d);
 void hide_desktop(desktop_t *d);
+void create_desktop_container(desktop_t *d);
+void update_desktop_container(desktop_t *d);
+void destroy_desktop_container(desktop_t *d);
+void update_desktop_containers(void);
 bool is_urgent(desktop_t *d);
 
 #endif
@@ -27,18 +27,27 @@
 #include "ewmh.h"
 #include "monitor.h"
 #include "query.h"
+#include "record.h"
 #include "settings.h"
 #include "subscribe.h"
 #include "tree.h"
 #include "window.h"
 #include "pointer.h"
 #include "rule.h"
+#include "stats.h"
+#include "trace.h"
 #include "events.h"
+#include "accounting.h"
 
 uint8_t randr_base;
 
 void handle_event(xcb_generic_event_t *evt)
 {
+	if (recording != NULL) {
+		record_event(evt);
+	}
+
+	uint64_t start = get_time_ns();
 	uint8_t resp_type = XCB_EVENT_RESPONSE_TYPE(evt);
 	switch (resp_type) {
 		case XCB_MAP_REQUEST:
@@ -66,11 +75,20 @@ void handle_event(xcb_generic_event_t *evt)
 			enter_notify(evt);
 			break;
 		case XCB_MOTION_NOTIFY:
-			motion_notify(evt);
+			if (grabbing) {
+				drag_motion((xcb_motion_notify_event_t *) evt);
+			} else {
+				motion_notify(evt);
+			}
 			break;
 		case XCB_BUTTON_PRESS:
 			button_press(evt);
 			break;
+		case XCB_BUTTON_RELEASE:
+			if (grabbing) {
+				end_drag();
+			}
+			break;
 		case XCB_FOCUS_IN:
 			focus_in(evt);
 			break;
@@ -82,10 +100,12 @@ void handle_event(xcb_generic_event_t *evt)
 			break;
 		default:
 			if (randr && resp_type == randr_base + XCB_RANDR_SCREEN_CHANGE_NOTIFY) {
-				update_monitors();
+				schedule_monitors_update();
 			}
 			break;
 	}
+	add_event_latency(resp_type, get_time_ns() - start);
+	trace_end("handle_event", xcb_event_get_label(resp_type), start);
 }
 
 void map_request(xcb_generic_event_t *evt)
@@ -254,6 +274,11 @@ void unmap_notify(xcb_generic_event_t *evt)
 		return;
 	}
 
+	coordinates_t loc;
+	if (locate_window(e->window, &loc) && loc.node->client->container != XCB_NONE) {
+		reparent_node(NULL, loc.node);
+	}
+
 	set_window_state(e->window, XCB_ICCCM_WM_STATE_WITHDRAWN);
 	unmanage_window(e->window);
 }
@@ -262,10 +287,10 @@ void property_notify(xcb_generic_event_t *evt)
 {
 	xcb_property_notify_event_t *e = (xcb_property_notify_event_t *) evt;
 
-	if (!ignore_ewmh_struts && e->atom == ewmh->_NET_WM_STRUT_PARTIAL && ewmh_handle_struts(e->window)) {
+	if (!ignore_ewmh_struts && e->atom == ewmh->_NET_WM_STRUT_PARTIAL && ewmh_handle_struts(xcb_ewmh_get_wm_strut_partial(ewmh, e->window))) {
 		for (monitor_t *m = mon_head; m != NULL; m = m->next) {
 			for (desktop_t *d = m->desk_head; d != NULL; d = d->next) {
-				arrange(m, d);
+				arrange_lazily(m, d);
 			}
 		}
 	}
@@ -409,14 +434,15 @@ void enter_notify(xcb_generic_event_t *evt)
 		return;
 	}
 
-	if (win == mon->root || (mon->desk->focus != NULL &&
+	if (win == mon->root || win == mon->desk->container || (mon->desk->focus != NULL &&
 	                         (win == mon->desk->focus->id ||
 	                          (mon->desk->focus->presel != NULL &&
 	                           win == mon->desk->focus->presel->feedback)))) {
 		return;
 	}
 
-	update_motion_recorder();
+	update_motion_recorder_at((xcb_point_t) {e->root_x, e->root_y});
+	pointer_round_trips_saved++;
 }
 
 void motion_notify(xcb_generic_event_t *evt)
@@ -442,8 +468,13 @@ void motion_notify(xcb_generic_event_t *evt)
 
 	disable_motion_recorder();
 
-	xcb_window_t win = XCB_NONE;
-	query_pointer(&win, NULL);
+	/* the window under the pointer is found from the event's coordinates
+	 * rather than by querying the server */
+	xcb_point_t pt = {e->root_x, e->root_y};
+	node_t *n = node_from_point(pt);
+	pointer_round_trips_saved++;
+	pointer_motion_time += dtime;
+
 	coordinates_t loc;
 	bool pff = pointer_follows_focus;
 	bool pfm = pointer_follows_monitor;
@@ -451,12 +482,11 @@ void motion_notify(xcb_generic_event_t *evt)
 	pointer_follows_monitor = false;
 	auto_raise = false;
 
-	if (locate_window(win, &loc)) {
+	if (n != NULL && n->client != NULL && locate_window(n->id, &loc)) {
 		if (loc.monitor->desk == loc.desktop && loc.node != mon->desk->focus) {
 			focus_node(loc.monitor, loc.desktop, loc.node);
 		}
 	} else {
-		xcb_point_t pt = {e->root_x, e->root_y};
 		monitor_t *m = monitor_from_point(pt);
 		if (m != NULL && m != mon) {
 			focus_node(m, m->desk, m->desk->focus);
@@ -30,8 +30,15 @@
 #include "settings.h"
 #include "tree.h"
 #include "ewmh.h"
+#include "accounting.h"
 
 xcb_ewmh_connection_t *ewmh;
+unsigned int ewmh_dirty;
+xcb_window_t *ewmh_clients;
+uint32_t ewmh_clients_len;
+uint32_t ewmh_clients_size;
+uint32_t ewmh_clients_published;
+bool ewmh_clients_replace;
 
 void ewmh_init(void)
 {
@@ -39,15 +46,63 @@ void ewmh_init(void)
 	if (xcb_ewmh_init_atoms_replies(ewmh, xcb_ewmh_init_atoms(dpy, ewmh), NULL) == 0) {
 		err("Can't initialize EWMH atoms.\n");
 	}
+	/* drop the client lists left by a previous window manager */
+	ewmh_clients_replace = true;
+	ewmh_dirty |= EWMH_CLIENT_LIST | EWMH_CLIENT_LIST_STACKING;
+}
+
+/* The root window properties are marked as dirty and published once per
+ * iteration of the event loop. */
+void ewmh_flush(void)
+{
+	unsigned int dirty = ewmh_dirty;
+	ewmh_dirty = 0;
+	if (dirty & EWMH_NUMBER_OF_DESKTOPS) {
+		ewmh_publish_number_of_desktops();
+	}
+	if (dirty & EWMH_DESKTOP_NAMES) {
+		ewmh_publish_desktop_names();
+	}
+	if (dirty & EWMH_DESKTOP_VIEWPORT) {
+		ewmh_publish_desktop_viewport();
+	}
+	if (dirty & EWMH_CURRENT_DESKTOP) {
+		ewmh_publish_current_desktop();
+	}
+	if (dirty & EWMH_WM_DESKTOPS) {
+		ewmh_publish_wm_desktops();
+	}
+	if (dirty & EWMH_CLIENT_LIST) {
+		ewmh_publish_client_list();
+	}
+	if (dirty & EWMH_CLIENT_LIST_STACKING) {
+		ewmh_publish_client_list_stacking();
+	}
+	if (dirty & EWMH_ACTIVE_WINDOW) {
+		ewmh_publish_active_window();
+	}
 }
 
 void ewmh_update_active_window(void)
 {
+	ewmh_dirty |= EWMH_ACTIVE_WINDOW;
+}
+
+void ewmh_publish_active_window(void)
+{
+	if (mon == NULL) {
+		return;
+	}
 	xcb_window_t win = ((mon->desk->focus == NULL || mon->desk->focus->client == NULL) ? XCB_NONE : mon->desk->focus->id);
 	xcb_ewmh_set_active_window(ewmh, default_screen, win);
 }
 
 void ewmh_update_number_of_desktops(void)
+{
+	ewmh_dirty |= EWMH_NUMBER_OF_DESKTOPS;
+}
+
+void ewmh_publish_number_of_desktops(void)
 {
 	uint32_t desktops_count = 0;
 
@@ -89,6 +144,11 @@ bool ewmh_locate_desktop(uint32_t i, coordinates_t *loc)
 }
 
 void ewmh_update_current_desktop(void)
+{
+	ewmh_dirty |= EWMH_CURRENT_DESKTOP;
+}
+
+void ewmh_publish_current_desktop(void)
 {
 	if (mon == NULL) {
 		return;
@@ -109,6 +169,11 @@ void ewmh_set_wm_desktop(node_t *n, desktop_t *d)
 }
 
 void ewmh_update_wm_desktops(void)
+{
+	ewmh_dirty |= EWMH_WM_DESKTOPS;
+}
+
+void ewmh_publish_wm_desktops(void)
 {
 	for (monitor_t *m = mon_head; m != NULL; m = m->next) {
 		for (desktop_t *d = m->desk_head; d != NULL; d = d->next) {
@@ -124,6 +189,11 @@ void ewmh_update_wm_desktops(void)
 }
 
 void ewmh_update_desktop_names(void)
+{
+	ewmh_dirty |= EWMH_DESKTOP_NAMES;
+}
+
+void ewmh_publish_desktop_names(void)
 {
 	char names[MAXLEN];
 	unsigned int i, j;
@@ -152,6 +222,11 @@ void ewmh_update_desktop_names(void)
 }
 
 void ewmh_update_desktop_viewport(void)
+{
+	ewmh_dirty |= EWMH_DESKTOP_VIEWPORT;
+}
+
+void ewmh_publish_desktop_viewport(void)
 {
 	uint32_t desktops_count = 0;
 	for (monitor_t *m = mon_head; m != NULL; m = m->next) {
@@ -173,11 +248,11 @@ void ewmh_update_desktop_viewport(void)
 	xcb_ewmh_set_desktop_viewport(ewmh, default_screen, desktop, coords);
 }
 
-bool ewmh_handle_struts(xcb_window_t win)
+bool ewmh_handle_struts(xcb_get_property_cookie_t cookie)
 {
 	xcb_ewmh_wm_strut_partial_t struts;
 	bool changed = false;
-	if (xcb_ewmh_get_wm_strut_partial_reply(ewmh, xcb_ewmh_get_wm_strut_partial(ewmh, win), &struts, NULL) == 1) {
+	if (xcb_ewmh_get_wm_strut_partial_reply(ewmh, cookie, &struts, NULL) == 1) {
 		for (monitor_t *m = mon_head; m != NULL; m = m->next) {
 			xcb_rectangle_t rect = m->rectangle;
 			if (rect.x < (int16_t) struts.left &&
@@ -233,10 +308,74 @@ bool ewmh_handle_struts(xcb_window_t win)
 	return changed;
 }
 
+/* Rebuilds the client list from the trees. */
 void ewmh_update_client_list(bool stacking)
+{
+	if (stacking) {
+		ewmh_dirty |= EWMH_CLIENT_LIST_STACKING;
+		return;
+	}
+	ewmh_clients_len = 0;
+	for (monitor_t *m = mon_head; m != NULL; m = m->next) {
+		for (desktop_t *d = m->desk_head; d != NULL; d = d->next) {
+			for (node_t *n = first_extrema(d->root); n != NULL; n = next_leaf(n, d->root)) {
+				if (n->client != NULL) {
+					ewmh_add_client(n->id);
+				}
+			}
+		}
+	}
+	ewmh_clients_replace = true;
+	ewmh_dirty |= EWMH_CLIENT_LIST;
+}
+
+/* The client list is kept in mapping order: the new clients are appended to
+ * the published property. */
+void ewmh_add_client(xcb_window_t win)
+{
+	if (ewmh_clients_len == ewmh_clients_size) {
+		uint32_t size = ewmh_clients_size > 0 ? 2 * ewmh_clients_size : 64;
+		xcb_window_t *clients = realloc(ewmh_clients, size * sizeof(xcb_window_t));
+		if (clients == NULL) {
+			return;
+		}
+		ewmh_clients = clients;
+		ewmh_clients_size = size;
+	}
+	ewmh_clients[ewmh_clients_len++] = win;
+	ewmh_dirty |= EWMH_CLIENT_LIST;
+}
+
+void ewmh_remove_client(xcb_window_t win)
+{
+	for (uint32_t i = 0; i < ewmh_clients_len; i++) {
+		if (ewmh_clients[i] == win) {
+			memmove(ewmh_clients + i, ewmh_clients + i + 1, (ewmh_clients_len - i - 1) * sizeof(xcb_window_t));
+			ewmh_clients_len--;
+			if (i < ewmh_clients_published) {
+				ewmh_clients_replace = true;
+			}
+			ewmh_dirty |= EWMH_CLIENT_LIST;
+			return;
+		}
+	}
+}
+
+void ewmh_publish_client_list(void)
+{
+	if (ewmh_clients_replace) {
+		xcb_ewmh_set_client_list(ewmh, default_screen, ewmh_clients_len, ewmh_clients);
+	} else if (ewmh_clients_published < ewmh_clients_len) {
+		xcb_change_property(dpy, XCB_PROP_MODE_APPEND, root, ewmh->_NET_CLIENT_LIST, XCB_ATOM_WINDOW, 32,
+		                    ewmh_clients_len - ewmh_clients_published, ewmh_clients + ewmh_clients_published);
+	}
+	ewmh_clients_published = ewmh_clients_len;
+	ewmh_clients_replace = false;
+}
+
+void ewmh_publish_client_list_stacking(void)
 {
 	if (clients_count == 0) {
-		xcb_ewmh_set_client_list(ewmh, default_screen, 0, NULL);
 		xcb_ewmh_set_client_list_stacking(ewmh, default_screen, 0, NULL);
 		return;
 	}
@@ -244,24 +383,10 @@ void ewmh_update_client_list(bool stacking)
 	xcb_window_t wins[clients_count];
 	unsigned int i = 0;
 
-	if (stacking) {
-		for (stacking_list_t *s = stack_head; s != NULL; s = s->next) {
-			wins[i++] = s->node->id;
-		}
-		xcb_ewmh_set_client_list_stacking(ewmh, default_screen, clients_count, wins);
-	} else {
-		for (monitor_t *m = mon_head; m != NULL; m = m->next) {
-			for (desktop_t *d = m->desk_head; d != NULL; d = d->next) {
-				for (node_t *n = first_extrema(d->root); n != NULL; n = next_leaf(n, d->root)) {
-					if (n->client == NULL) {
-						continue;
-					}
-					wins[i++] = n->id;
-				}
-			}
-		}
-		xcb_ewmh_set_client_list(ewmh, default_screen, clients_count, wins);
+	for (stacking_list_t *s = stack_head; s != NULL; s = s->next) {
+		wins[i++] = s->node->id;
 	}
+	xcb_ewmh_set_client_list_stacking(ewmh, default_screen, i, wins);
 }
 
 void ewmh_wm_state_update(node_t *n)
@@ -27,20 +27,48 @@
 
 #include <xcb/xcb_ewmh.h>
 
+typedef enum {
+	EWMH_ACTIVE_WINDOW = 1 << 0,
+	EWMH_NUMBER_OF_DESKTOPS = 1 << 1,
+	EWMH_CURRENT_DESKTOP = 1 << 2,
+	EWMH_WM_DESKTOPS = 1 << 3,
+	EWMH_DESKTOP_NAMES = 1 << 4,
+	EWMH_DESKTOP_VIEWPORT = 1 << 5,
+	EWMH_CLIENT_LIST = 1 << 6,
+	EWMH_CLIENT_LIST_STACKING = 1 << 7
+} ewmh_property_t;
+
 extern xcb_ewmh_connection_t *ewmh;
+extern unsigned int ewmh_dirty;
+extern xcb_window_t *ewmh_clients;
+extern uint32_t ewmh_clients_len;
+extern uint32_t ewmh_clients_size;
+extern uint32_t ewmh_clients_published;
+extern bool ewmh_clients_replace;
 
 void ewmh_init(void);
+void ewmh_flush(void);
 void ewmh_update_active_window(void);
+void ewmh_publish_active_window(void);
 void ewmh_update_number_of_desktops(void);
+void ewmh_publish_number_of_desktops(void);
 uint32_t ewmh_get_desktop_index(desktop_t *d);
 bool ewmh_locate_desktop(uint32_t i, coordinates_t *loc);
 void ewmh_update_current_desktop(void);
+void ewmh_publish_current_desktop(void);
 void ewmh_set_wm_desktop(node_t *n, desktop_t *d);
 void ewmh_update_wm_desktops(void);
+void ewmh_publish_wm_desktops(void);
 void ewmh_update_desktop_names(void);
+void ewmh_publish_desktop_names(void);
 void ewmh_update_desktop_viewport(void);
-bool ewmh_handle_struts(xcb_window_t win);
+void ewmh_publish_desktop_viewport(void);
+bool ewmh_handle_struts(xcb_get_property_cookie_t cookie);
 void ewmh_update_client_list(bool stacking);
+void ewmh_add_client(xcb_window_t win);
+void ewmh_remove_client(xcb_window_t win);
+void ewmh_publish_client_list(void);
+void ewmh_publish_client_list_stacking(void);
 void ewmh_wm_state_update(node_t *n);
 void ewmh_set_supporting(xcb_window_t win);
 
@@ -29,8 +29,10 @@
 #include <stdarg.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <fcntl.h>
 #include <ctype.h>
+#include <time.h>
 #include "bspwm.h"
 
 void warn(char *fmt, ...)
@@ -107,6 +109,48 @@ end:
 	return content;
 }
 
+char *map_file(const char *file_path, size_t *len)
+{
+	if (file_path == NULL) {
+		return NULL;
+	}
+
+	int fd = open(file_path, O_RDONLY);
+
+	if (fd == -1) {
+		perror("Map file: open");
+		return NULL;
+	}
+
+	struct stat sb;
+	char *content = NULL;
+
+	if (fstat(fd, &sb) == -1) {
+		perror("Map file: fstat");
+		goto end;
+	}
+
+	if (!S_ISREG(sb.st_mode) || sb.st_size == 0) {
+		warn("Map file: not a regular non-empty file: '%s'.\n", file_path);
+		goto end;
+	}
+
+	content = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+	if (content == MAP_FAILED) {
+		perror("Map file: mmap");
+		content = NULL;
+		goto end;
+	}
+
+	posix_madvise(content, sb.st_size, POSIX_MADV_SEQUENTIAL);
+	*len = sb.st_size;
+
+end:
+	close(fd);
+	return content;
+}
+
 char *copy_string(char *str, size_t len)
 {
 	char *cpy = calloc(1, ((len+1) * sizeof(char)));
@@ -193,6 +237,13 @@ bool is_hex_color(const char *color)
 	return true;
 }
 
+uint64_t get_time_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
 char *tokenize_with_escape(struct tokenize_state *state, const char *s, char sep)
 {
 	if (s != NULL) {
@@ -33,10 +33,15 @@
 #include "desktop.h"
 #include "monitor.h"
 #include "pointer.h"
+#include "publish.h"
 #include "query.h"
+#include "record.h"
 #include "rule.h"
 #include "restore.h"
+#include "snapshot.h"
 #include "settings.h"
+#include "stats.h"
+#include "trace.h"
 #include "tree.h"
 #include "window.h"
 #include "common.h"
@@ -45,6 +50,10 @@
 
 void handle_message(char *msg, int msg_len, FILE *rsp)
 {
+	if (recording != NULL) {
+		record_message(msg, msg_len);
+	}
+
 	int cap = INIT_CAP;
 	int num = 0;
 	char **args = calloc(cap, sizeof(char *));
@@ -79,12 +88,24 @@ void handle_message(char *msg, int msg_len, FILE *rsp)
 	}
 
 	char **args_orig = args;
+	uint64_t start = trace_begin();
 	process_message(args, num, rsp);
+	if (tracing) {
+		char key[TRACE_DETAIL_LEN];
+		get_command_key(args_orig, num, key, sizeof(key));
+		trace_end("handle_message", key, start);
+	}
 	free(args_orig);
 }
 
 void process_message(char **args, int num, FILE *rsp)
 {
+	uint64_t start = get_time_ns();
+	char **args_orig = args;
+	int num_orig = num;
+	x_usage_t usage = {0, 0, 0};
+	command_usage = &usage;
+
 	if (streq("node", *args)) {
 		cmd_node(++args, --num, rsp);
 	} else if (streq("desktop", *args)) {
@@ -95,6 +116,7 @@ void process_message(char **args, int num, FILE *rsp)
 		cmd_query(++args, --num, rsp);
 	} else if (streq("subscribe", *args)) {
 		cmd_subscribe(++args, --num, rsp);
+		command_usage = NULL;
 		return;
 	} else if (streq("wm", *args)) {
 		cmd_wm(++args, --num, rsp);
@@ -110,6 +132,9 @@ void process_message(char **args, int num, FILE *rsp)
 
 	fflush(rsp);
 	fclose(rsp);
+
+	command_usage = NULL;
+	add_command_latency(args_orig, num_orig, get_time_ns() - start, &usage);
 }
 
 void cmd_node(char **args, int num, FILE *rsp)
@@ -1194,6 +1219,7 @@ void cmd_rule(char **args, int num, FILE *rsp)
 			free(instance_name);
 			free(name);
 
+			char *cause = *args;
 			num--, args++;
 			size_t i = 0;
 			while (num > 0) {
@@ -1210,7 +1236,11 @@ void cmd_rule(char **args, int num, FILE *rsp)
 				num--, args++;
 			}
 			rule->effect[MIN(i, sizeof(rule->effect) - 1)] = '\0';
-			add_rule(rule);
+			if (!add_rule(rule)) {
+				fail(rsp, "rule -a: Invalid pattern: '%s'.\n", cause);
+				free(rule);
+				return;
+			}
 		} else if (streq("-r", *args) || streq("--remove", *args)) {
 			num--, args++;
 			if (num < 1) {
@@ -1231,7 +1261,9 @@ void cmd_rule(char **args, int num, FILE *rsp)
 				num--, args++;
 			}
 		} else if (streq("-l", *args) || streq("--list", *args)) {
-			list_rules(rsp);
+			list_rules(rsp, false);
+		} else if (streq("-H", *args) || streq("--hits", *args)) {
+			list_rules(rsp, true);
 		} else {
 			fail(rsp, "rule: Unknown command: '%s'.\n", *args);
 			return;
@@ -1261,6 +1293,16 @@ void cmd_wm(char **args, int num, FILE *rsp)
 				fail(rsp, "");
 				break;
 			}
+		} else if (streq("-s", *args) || streq("--save-state", *args)) {
+			num--, args++;
+			if (num < 1) {
+				fail(rsp, "wm %s: Not enough arguments.\n", *(args - 1));
+				break;
+			}
+			if (!save_snapshot(*args)) {
+				fail(rsp, "wm %s: Can't save the snapshot: '%s'.\n", *(args - 1), *args);
+				break;
+			}
 		} else if (streq("-a", *args) || streq("--add-monitor", *args)) {
 			num--, args++;
 			if (num < 2) {
@@ -1314,6 +1356,36 @@ void cmd_wm(char **args, int num, FILE *rsp)
 				fail(rsp, "wm %s: Invalid argument: '%s'.\n", *(args - 1), *args);
 				break;
 			}
+		} else if (streq("-S", *args) || streq("--stats", *args)) {
+			print_stats(rsp);
+			fprintf(rsp, "\n");
+			if (num > 1 && streq("--reset", *(args + 1))) {
+				reset_stats();
+				num--, args++;
+			}
+		} else if (streq("--trace-start", *args)) {
+			num--, args++;
+			if (num < 1) {
+				fail(rsp, "wm %s: Not enough arguments.\n", *(args - 1));
+				break;
+			}
+			if ((*args)[0] != '/') {
+				fail(rsp, "wm %s: The path must be absolute: '%s'.\n", *(args - 1), *args);
+				break;
+			}
+			if (!trace_start(*args)) {
+				fail(rsp, "wm %s: Couldn't start tracing.\n", *(args - 1));
+				break;
+			}
+		} else if (streq("--trace-stop", *args)) {
+			if (!tracing) {
+				fail(rsp, "wm %s: Not tracing.\n", *args);
+				break;
+			}
+			if (!trace_stop()) {
+				fail(rsp, "wm %s: Couldn't write the trace.\n", *args);
+				break;
+			}
 		} else if (streq("-r", *args) || streq("--restart", *args)) {
 			running = false;
 			restart = true;
@@ -1330,9 +1402,13 @@ void cmd_subscribe(char **args, int num, FILE *rsp)
 {
 	int field = 0;
 	int count = -1;
+	int coalesce = 0;
+	unsigned int max_rate = 0;
 	FILE *stream = rsp;
 	char *fifo_path = NULL;
 	subscriber_mask_t mask;
+	coordinates_t ref = {mon, mon->desk, mon->desk->focus};
+	coordinates_t filter = {NULL, NULL, NULL};
 
 	while (num > 0) {
 		if (streq("-c", *args) || streq("--count", *args)) {
@@ -1345,6 +1421,72 @@ void cmd_subscribe(char **args, int num, FILE *rsp)
 				fail(rsp, "subscribe %s: Invalid argument: '%s'.\n", *(args - 1), *args);
 				goto failed;
 			}
+		} else if (streq("--max-rate", *args)) {
+			num--, args++;
+			if (num < 1) {
+				fail(rsp, "subscribe %s: Not enough arguments.\n", *(args - 1));
+				goto failed;
+			}
+			char unit[3] = {0};
+			int n = sscanf(*args, "%u%2s", &max_rate, unit);
+			if (n < 1 || max_rate < 1 || (n == 2 && !streq("/s", unit))) {
+				fail(rsp, "subscribe %s: Invalid argument: '%s'.\n", *(args - 1), *args);
+				goto failed;
+			}
+		} else if (streq("--coalesce", *args)) {
+			num--, args++;
+			if (num < 1) {
+				fail(rsp, "subscribe %s: Not enough arguments.\n", *(args - 1));
+				goto failed;
+			}
+			char *name = strtok(*args, ",");
+			while (name != NULL) {
+				if (!parse_subscriber_mask(name, &mask)) {
+					fail(rsp, "subscribe %s: Invalid event: '%s'.\n", *(args - 1), name);
+					goto failed;
+				}
+				coalesce |= mask;
+				name = strtok(NULL, ",");
+			}
+		} else if (streq("-m", *args) || streq("--monitor", *args)) {
+			num--, args++;
+			if (num < 1) {
+				fail(rsp, "subscribe %s: Not enough arguments.\n", *(args - 1));
+				goto failed;
+			}
+			coordinates_t trg = ref;
+			int ret;
+			if ((ret = monitor_from_desc(*args, &ref, &trg)) != SELECTOR_OK) {
+				handle_failure(ret, "subscribe -m", *args, rsp);
+				goto failed;
+			}
+			filter.monitor = trg.monitor;
+		} else if (streq("-d", *args) || streq("--desktop", *args)) {
+			num--, args++;
+			if (num < 1) {
+				fail(rsp, "subscribe %s: Not enough arguments.\n", *(args - 1));
+				goto failed;
+			}
+			coordinates_t trg = ref;
+			int ret;
+			if ((ret = desktop_from_desc(*args, &ref, &trg)) != SELECTOR_OK) {
+				handle_failure(ret, "subscribe -d", *args, rsp);
+				goto failed;
+			}
+			filter.desktop = trg.desktop;
+		} else if (streq("-n", *args) || streq("--node", *args)) {
+			num--, args++;
+			if (num < 1) {
+				fail(rsp, "subscribe %s: Not enough arguments.\n", *(args - 1));
+				goto failed;
+			}
+			coordinates_t trg = ref;
+			int ret;
+			if ((ret = node_from_desc(*args, &ref, &trg)) != SELECTOR_OK) {
+				handle_failure(ret, "subscribe -n", *args, rsp);
+				goto failed;
+			}
+			filter.node = trg.node;
 		} else if (streq("-f", *args) || streq("--fifo", *args)) {
 			fifo_path = mktempfifo(FIFO_TEMPLATE);
 			if (fifo_path == NULL) {
@@ -1378,6 +1520,11 @@ void cmd_subscribe(char **args, int num, FILE *rsp)
 	}
 
 	subscriber_list_t *sb = make_subscriber(stream, fifo_path, field, count);
+	sb->monitor_id = filter.monitor != NULL ? filter.monitor->id : 0;
+	sb->desktop_id = filter.desktop != NULL ? filter.desktop->id : 0;
+	sb->node_id = filter.node != NULL ? filter.node->id : 0;
+	sb->max_rate = max_rate;
+	sb->coalesce = coalesce;
 	add_subscriber(sb);
 	return;
 
@@ -1672,6 +1819,19 @@ void set_setting(coordinates_t loc, char *name, char *value, FILE *rsp)
 			fail(rsp, "config: %s: Invalid value: '%s'.\n", name, value);
 			return;
 		}
+	} else if (streq("pointer_drag_mode", name)) {
+		drag_mode_t m;
+		if (parse_drag_mode(value, &m)) {
+			pointer_drag_mode = m;
+		} else {
+			fail(rsp, "config: %s: Invalid value: '%s'.\n", name, value);
+			return;
+		}
+	} else if (streq("external_rules_timeout", name)) {
+		if (sscanf(value, "%u", &external_rules_timeout) != 1) {
+			fail(rsp, "config: %s: Invalid value: '%s'.\n", name, value);
+			return;
+		}
 	} else if (streq("pointer_action1", name) ||
 	           streq("pointer_action2", name) ||
 	           streq("pointer_action3", name)) {
@@ -1737,12 +1897,46 @@ void set_setting(coordinates_t loc, char *name, char *value, FILE *rsp)
 			fail(rsp, "config: %s: Invalid value: '%s'.\n", name, value);
 			return;
 		}
+	} else if (streq("state_mirror", name)) {
+		bool b;
+		if (parse_bool(value, &b)) {
+			if (b == state_mirror) {
+				return;
+			}
+			if (b) {
+				if (!publish_init()) {
+					fail(rsp, "config: %s: Can't create the shared memory segment.\n", name);
+					return;
+				}
+			} else {
+				publish_cleanup(true);
+			}
+			state_mirror = b;
+			return;
+		} else {
+			fail(rsp, "config: %s: Invalid value: '%s'.\n", name, value);
+			return;
+		}
+	} else if (streq("desktop_containers", name)) {
+		bool b;
+		if (parse_bool(value, &b)) {
+			if (b == desktop_containers) {
+				return;
+			}
+			desktop_containers = b;
+			update_desktop_containers();
+			return;
+		} else {
+			fail(rsp, "config: %s: Invalid value: '%s'.\n", name, value);
+			return;
+		}
 #define SET_BOOL(s) \
 	} else if (streq(#s, name)) { \
 		if (!parse_bool(value, &s)) { \
 			fail(rsp, "config: %s: Invalid value: '%s'.\n", name, value); \
 			return; \
 		}
+		SET_BOOL(external_rules_daemon)
 		SET_BOOL(presel_feedback)
 		SET_BOOL(borderless_monocle)
 		SET_BOOL(gapless_monocle)
@@ -1776,7 +1970,7 @@ void set_setting(coordinates_t loc, char *name, char *value, FILE *rsp)
 
 	for (monitor_t *m = mon_head; m != NULL; m = m->next) {
 		for (desktop_t *d = m->desk_head; d != NULL; d = d->next) {
-			arrange(m, d);
+			arrange_lazily(m, d);
 			if (colors_changed) {
 				update_colors_in(d->root, d, m);
 			}
@@ -1838,6 +2032,8 @@ void get_setting(coordinates_t loc, char *name, FILE* rsp)
 		fprintf(rsp, "%i", monocle_padding.left);
 	} else if (streq("external_rules_command", name)) {
 		fprintf(rsp, "%s", external_rules_command);
+	} else if (streq("external_rules_timeout", name)) {
+		fprintf(rsp, "%u", external_rules_timeout);
 	} else if (streq("status_prefix", name)) {
 		fprintf(rsp, "%s", status_prefix);
 	} else if (streq("initial_polarity", name)) {
@@ -1856,6 +2052,8 @@ void get_setting(coordinates_t loc, char *name, FILE* rsp)
 		print_button_index(click_to_focus, rsp);
 	} else if (streq("pointer_motion_interval", name)) {
 		fprintf(rsp, "%u", pointer_motion_interval);
+	} else if (streq("pointer_drag_mode", name)) {
+		fprintf(rsp, "%s", DRAG_MODE_STR(pointer_drag_mode));
 	} else if (streq("pointer_action1", name) ||
 	           streq("pointer_action2", name) ||
 	           streq("pointer_action3", name)) {
@@ -1872,6 +2070,7 @@ void get_setting(coordinates_t loc, char *name, FILE* rsp)
 #define GET_BOOL(s) \
 	} else if (streq(#s, name)) { \
 		fprintf(rsp, "%s", BOOL_STR(s));
+	GET_BOOL(external_rules_daemon)
 	GET_BOOL(presel_feedback)
 	GET_BOOL(borderless_monocle)
 	GET_BOOL(gapless_monocle)
@@ -1889,6 +2088,8 @@ void get_setting(coordinates_t loc, char *name, FILE* rsp)
 	GET_BOOL(remove_disabled_monitors)
 	GET_BOOL(remove_unplugged_monitors)
 	GET_BOOL(merge_overlapping_monitors)
+	GET_BOOL(state_mirror)
+	GET_BOOL(desktop_containers)
 #undef GET_BOOL
 	} else {
 		fail(rsp, "config: Unknown setting: '%s'.\n", name);
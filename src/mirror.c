@@ -0,0 +1,226 @@
+/* Copyright (c) 2012, Bastien Dejean
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "helpers.h"
+#include "mirror.h"
+
+#define MIRROR_READ_ATTEMPTS  64
+
+bool mirror_open(mirror_t *mr, const char *name)
+{
+	mr->data = mr->copy = NULL;
+	mr->size = mr->copy_size = 0;
+
+	if ((mr->fd = shm_open(name, O_RDONLY, 0)) == -1) {
+		return false;
+	}
+
+	struct stat sb;
+
+	if (fstat(mr->fd, &sb) == -1 || (size_t) sb.st_size < sizeof(mirror_header_t)) {
+		close(mr->fd);
+		return false;
+	}
+
+	mr->size = sb.st_size;
+	mr->data = mmap(NULL, mr->size, PROT_READ, MAP_SHARED, mr->fd, 0);
+
+	if (mr->data == MAP_FAILED) {
+		mr->data = NULL;
+		close(mr->fd);
+		return false;
+	}
+
+	return true;
+}
+
+/* Returns a consistent private copy of the segment, valid until the next call. */
+const mirror_header_t *mirror_read(mirror_t *mr)
+{
+	for (int i = 0; i < MIRROR_READ_ATTEMPTS; i++) {
+		const mirror_header_t *h = (const mirror_header_t *) mr->data;
+		uint32_t seq = __atomic_load_n(&h->sequence, __ATOMIC_ACQUIRE);
+
+		if (seq & 1) {
+			continue;
+		}
+
+		if (h->magic != MIRROR_MAGIC || h->version != MIRROR_VERSION) {
+			return NULL;
+		}
+
+		size_t size = h->size;
+
+		/* the writer only ever grows the segment */
+		if (size > mr->size) {
+			munmap((void *) mr->data, mr->size);
+			mr->data = mmap(NULL, size, PROT_READ, MAP_SHARED, mr->fd, 0);
+			if (mr->data == MAP_FAILED) {
+				mr->data = NULL;
+				mr->size = 0;
+				return NULL;
+			}
+			mr->size = size;
+			continue;
+		}
+
+		if (size > mr->copy_size) {
+			uint8_t *copy = realloc(mr->copy, size);
+			if (copy == NULL) {
+				return NULL;
+			}
+			mr->copy = copy;
+			mr->copy_size = size;
+		}
+
+		memcpy(mr->copy, mr->data, size);
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+		if (__atomic_load_n(&h->sequence, __ATOMIC_RELAXED) == seq) {
+			return (const mirror_header_t *) mr->copy;
+		}
+	}
+
+	return NULL;
+}
+
+void mirror_close(mirror_t *mr)
+{
+	if (mr->data != NULL) {
+		munmap((void *) mr->data, mr->size);
+		close(mr->fd);
+	}
+	free(mr->copy);
+	mr->data = mr->copy = NULL;
+	mr->size = mr->copy_size = 0;
+}
+
+const mirror_monitor_t *mirror_monitors(const mirror_header_t *h)
+{
+	return (const mirror_monitor_t *) (h + 1);
+}
+
+const mirror_desktop_t *mirror_desktops(const mirror_header_t *h)
+{
+	return (const mirror_desktop_t *) (mirror_monitors(h) + h->monitors_count);
+}
+
+const mirror_leaf_t *mirror_leaves(const mirror_header_t *h)
+{
+	return (const mirror_leaf_t *) (mirror_desktops(h) + h->desktops_count);
+}
+
+size_t mirror_size(uint32_t monitors_count, uint32_t desktops_count, uint32_t leaves_count)
+{
+	return sizeof(mirror_header_t) +
+	       monitors_count * sizeof(mirror_monitor_t) +
+	       desktops_count * sizeof(mirror_desktop_t) +
+	       leaves_count * sizeof(mirror_leaf_t);
+}
+
+/* Answers the subset of the query command that the mirror can serve:
+ * returns false when the socket has to be used instead. */
+bool mirror_query(const mirror_header_t *h, int argc, char *argv[], FILE *rsp)
+{
+	char dom = 0, sel = 0;
+	bool print_names = false;
+
+	for (; argc > 0; argc--, argv++) {
+		if (streq("-M", *argv) || streq("--monitors", *argv)) {
+			dom = dom == 0 ? 'M' : -1;
+		} else if (streq("-D", *argv) || streq("--desktops", *argv)) {
+			dom = dom == 0 ? 'D' : -1;
+		} else if (streq("-N", *argv) || streq("--nodes", *argv)) {
+			dom = dom == 0 ? 'N' : -1;
+		} else if (streq("-m", *argv) || streq("--monitor", *argv)) {
+			sel = sel == 0 ? 'm' : -1;
+		} else if (streq("-d", *argv) || streq("--desktop", *argv)) {
+			sel = sel == 0 ? 'd' : -1;
+		} else if (streq("-n", *argv) || streq("--node", *argv)) {
+			sel = sel == 0 ? 'n' : -1;
+		} else if (streq("--names", *argv)) {
+			print_names = true;
+		} else {
+			return false;
+		}
+	}
+
+	const mirror_monitor_t *mm = mirror_monitors(h);
+	const mirror_desktop_t *md = mirror_desktops(h);
+
+	if (dom == 'M' && (sel == 0 || sel == 'm')) {
+		for (uint32_t i = 0; i < h->monitors_count; i++) {
+			if (sel == 'm' && mm[i].id != h->focused_monitor_id) {
+				continue;
+			}
+			if (print_names) {
+				fprintf(rsp, "%s\n", mm[i].name);
+			} else {
+				fprintf(rsp, "0x%08X\n", mm[i].id);
+			}
+		}
+		return true;
+	} else if (dom == 'D' && (sel == 0 || sel == 'm' || sel == 'd')) {
+		uint32_t focused_desktop_id = 0;
+		for (uint32_t i = 0; i < h->monitors_count; i++) {
+			if (mm[i].id == h->focused_monitor_id) {
+				focused_desktop_id = mm[i].focused_desktop_id;
+			}
+		}
+		for (uint32_t i = 0; i < h->desktops_count; i++) {
+			if ((sel == 'm' && md[i].monitor_id != h->focused_monitor_id) ||
+			    (sel == 'd' && md[i].id != focused_desktop_id)) {
+				continue;
+			}
+			if (print_names) {
+				fprintf(rsp, "%s\n", md[i].name);
+			} else {
+				fprintf(rsp, "0x%08X\n", md[i].id);
+			}
+		}
+		return true;
+	} else if (dom == 'N' && sel == 'n' && !print_names) {
+		const mirror_leaf_t *ml = mirror_leaves(h);
+		for (uint32_t i = 0; i < h->leaves_count; i++) {
+			if (!(ml[i].flags & MIRROR_LEAF_FOCUSED)) {
+				continue;
+			}
+			for (uint32_t j = 0; j < h->monitors_count; j++) {
+				if (mm[j].id == h->focused_monitor_id && mm[j].focused_desktop_id == ml[i].desktop_id) {
+					fprintf(rsp, "0x%08X\n", ml[i].id);
+					return true;
+				}
+			}
+		}
+	}
+
+	return false;
+}
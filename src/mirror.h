@@ -0,0 +1,116 @@
+/* Copyright (c) 2012, Bastien Dejean
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef BSPWM_MIRROR_H
+#define BSPWM_MIRROR_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/* Read-only mirror of the window manager's state published in a shared
+ * memory segment when the *state_mirror* setting is enabled. The segment
+ * starts with a header followed by the monitors, the desktops and the
+ * leaves. The writer increments the sequence number before and after each
+ * update: readers retry until they copy the segment under the same even
+ * sequence number. */
+
+#define MIRROR_MAGIC      0x4D535042
+#define MIRROR_VERSION    1
+#define MIRROR_NAME_LEN   32
+#define MIRROR_CLASS_LEN  64
+
+typedef enum {
+	MIRROR_LEAF_HIDDEN = 1 << 0,
+	MIRROR_LEAF_STICKY = 1 << 1,
+	MIRROR_LEAF_PRIVATE = 1 << 2,
+	MIRROR_LEAF_LOCKED = 1 << 3,
+	MIRROR_LEAF_MARKED = 1 << 4,
+	MIRROR_LEAF_URGENT = 1 << 5,
+	MIRROR_LEAF_SHOWN = 1 << 6,
+	MIRROR_LEAF_FOCUSED = 1 << 7
+} mirror_leaf_flags_t;
+
+typedef struct {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t sequence;
+	uint32_t size;
+	uint32_t focused_monitor_id;
+	uint32_t monitors_count;
+	uint32_t desktops_count;
+	uint32_t leaves_count;
+} mirror_header_t;
+
+typedef struct {
+	uint32_t id;
+	uint32_t focused_desktop_id;
+	int16_t x, y;
+	uint16_t width, height;
+	uint32_t desktops_count;
+	char name[MIRROR_NAME_LEN];
+} mirror_monitor_t;
+
+typedef struct {
+	uint32_t id;
+	uint32_t monitor_id;
+	uint32_t focused_node_id;
+	uint32_t leaves_count;
+	uint8_t layout;
+	uint8_t urgent;
+	char name[MIRROR_NAME_LEN];
+} mirror_desktop_t;
+
+typedef struct {
+	uint32_t id;
+	uint32_t desktop_id;
+	int16_t x, y;
+	uint16_t width, height;
+	uint8_t state;
+	uint8_t layer;
+	uint8_t flags;
+	char class_name[MIRROR_CLASS_LEN];
+	char instance_name[MIRROR_CLASS_LEN];
+} mirror_leaf_t;
+
+typedef struct {
+	int fd;
+	size_t size;
+	const uint8_t *data;
+	uint8_t *copy;
+	size_t copy_size;
+} mirror_t;
+
+bool mirror_open(mirror_t *mr, const char *name);
+const mirror_header_t *mirror_read(mirror_t *mr);
+void mirror_close(mirror_t *mr);
+const mirror_monitor_t *mirror_monitors(const mirror_header_t *h);
+const mirror_desktop_t *mirror_desktops(const mirror_header_t *h);
+const mirror_leaf_t *mirror_leaves(const mirror_header_t *h);
+size_t mirror_size(uint32_t monitors_count, uint32_t desktops_count, uint32_t leaves_count);
+bool mirror_query(const mirror_header_t *h, int argc, char *argv[], FILE *rsp);
+
+#endif
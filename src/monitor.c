@@ -37,7 +37,12 @@
 #include "tree.h"
 #include "subscribe.h"
 #include "window.h"
+#include "stats.h"
 #include "monitor.h"
+#include "accounting.h"
+
+uint64_t monitors_update_deadline;
+uint64_t monitors_change_start;
 
 monitor_t *make_monitor(const char *name, xcb_rectangle_t *rect, uint32_t id)
 {
@@ -68,17 +73,7 @@ void update_root(monitor_t *m, xcb_rectangle_t *rect)
 	xcb_rectangle_t last_rect = m->rectangle;
 	m->rectangle = *rect;
 	if (m->root == XCB_NONE) {
-		uint32_t values[] = {XCB_EVENT_MASK_ENTER_WINDOW};
-		m->root = xcb_generate_id(dpy);
-		xcb_create_window(dpy, XCB_COPY_FROM_PARENT, m->root, root,
-		                  rect->x, rect->y, rect->width, rect->height, 0,
-		                  XCB_WINDOW_CLASS_INPUT_ONLY, XCB_COPY_FROM_PARENT, XCB_CW_EVENT_MASK, values);
-		xcb_icccm_set_wm_class(dpy, m->root, sizeof(ROOT_WINDOW_IC), ROOT_WINDOW_IC);
-		xcb_icccm_set_wm_name(dpy, m->root, XCB_ATOM_STRING, 8, strlen(m->name), m->name);
-		window_lower(m->root);
-		if (focus_follows_pointer) {
-			window_show(m->root);
-		}
+		create_root(m);
 	} else {
 		window_move_resize(m->root, rect->x, rect->y, rect->width, rect->height);
 		put_status(SBSC_MASK_MONITOR_GEOMETRY, "monitor_geometry 0x%08X %ux%u+%i+%i\n",
@@ -91,11 +86,28 @@ void update_root(monitor_t *m, xcb_rectangle_t *rect)
 			}
 			adapt_geometry(&last_rect, rect, n);
 		}
-		arrange(m, d);
+		arrange_lazily(m, d);
+		update_desktop_container(d);
 	}
 	reorder_monitor(m);
 }
 
+void create_root(monitor_t *m)
+{
+	xcb_rectangle_t rect = m->rectangle;
+	uint32_t values[] = {XCB_EVENT_MASK_ENTER_WINDOW};
+	m->root = xcb_generate_id(dpy);
+	xcb_create_window(dpy, XCB_COPY_FROM_PARENT, m->root, root,
+	                  rect.x, rect.y, rect.width, rect.height, 0,
+	                  XCB_WINDOW_CLASS_INPUT_ONLY, XCB_COPY_FROM_PARENT, XCB_CW_EVENT_MASK, values);
+	xcb_icccm_set_wm_class(dpy, m->root, sizeof(ROOT_WINDOW_IC), ROOT_WINDOW_IC);
+	xcb_icccm_set_wm_name(dpy, m->root, XCB_ATOM_STRING, 8, strlen(m->name), m->name);
+	window_lower(m->root);
+	if (focus_follows_pointer) {
+		window_show(m->root);
+	}
+}
+
 void reorder_monitor(monitor_t *m)
 {
 	if (m == NULL) {
@@ -440,8 +452,11 @@ bool find_any_monitor(coordinates_t *ref, coordinates_t *dst, monitor_select_t *
 
 bool update_monitors(void)
 {
-	xcb_randr_get_screen_resources_reply_t *sres = xcb_randr_get_screen_resources_reply(dpy, xcb_randr_get_screen_resources(dpy, root), NULL);
+	xcb_randr_get_screen_resources_cookie_t sres_cookie = xcb_randr_get_screen_resources(dpy, root);
+	xcb_randr_get_output_primary_cookie_t gpo_cookie = xcb_randr_get_output_primary(dpy, root);
+	xcb_randr_get_screen_resources_reply_t *sres = xcb_randr_get_screen_resources_reply(dpy, sres_cookie, NULL);
 	if (sres == NULL) {
+		free(xcb_randr_get_output_primary_reply(dpy, gpo_cookie, NULL));
 		return false;
 	}
 
@@ -455,15 +470,25 @@ bool update_monitors(void)
 		cookies[i] = xcb_randr_get_output_info(dpy, outputs[i], XCB_CURRENT_TIME);
 	}
 
+	/* Request every CRTC before waiting for any of them */
+	xcb_randr_get_output_info_reply_t *infos[len];
+	xcb_randr_get_crtc_info_cookie_t crtc_cookies[len];
+	for (int i = 0; i < len; i++) {
+		infos[i] = xcb_randr_get_output_info_reply(dpy, cookies[i], NULL);
+		if (infos[i] != NULL && infos[i]->crtc != XCB_NONE) {
+			crtc_cookies[i] = xcb_randr_get_crtc_info(dpy, infos[i]->crtc, XCB_CURRENT_TIME);
+		}
+	}
+
 	for (monitor_t *m = mon_head; m != NULL; m = m->next) {
 		m->wired = false;
 	}
 
 	for (int i = 0; i < len; i++) {
-		xcb_randr_get_output_info_reply_t *info = xcb_randr_get_output_info_reply(dpy, cookies[i], NULL);
+		xcb_randr_get_output_info_reply_t *info = infos[i];
 		if (info != NULL) {
 			if (info->crtc != XCB_NONE) {
-				xcb_randr_get_crtc_info_reply_t *cir = xcb_randr_get_crtc_info_reply(dpy, xcb_randr_get_crtc_info(dpy, info->crtc, XCB_CURRENT_TIME), NULL);
+				xcb_randr_get_crtc_info_reply_t *cir = xcb_randr_get_crtc_info_reply(dpy, crtc_cookies[i], NULL);
 				if (cir != NULL) {
 					xcb_rectangle_t rect = (xcb_rectangle_t) {cir->x, cir->y, cir->width, cir->height};
 					last_wired = get_monitor_by_randr_id(outputs[i]);
@@ -491,7 +516,7 @@ bool update_monitors(void)
 		free(info);
 	}
 
-	xcb_randr_get_output_primary_reply_t *gpo = xcb_randr_get_output_primary_reply(dpy, xcb_randr_get_output_primary(dpy, root), NULL);
+	xcb_randr_get_output_primary_reply_t *gpo = xcb_randr_get_output_primary_reply(dpy, gpo_cookie, NULL);
 	if (gpo != NULL) {
 		pri_mon = get_monitor_by_randr_id(gpo->output);
 	}
@@ -555,3 +580,44 @@ bool update_monitors(void)
 
 	return (mon != NULL);
 }
+
+void ensure_monitors(void)
+{
+	if (mon != NULL) {
+		return;
+	}
+
+	if (!randr || !update_monitors()) {
+		xcb_rectangle_t rect = (xcb_rectangle_t) {0, 0, screen_width, screen_height};
+		monitor_t *m = make_monitor(NULL, &rect, XCB_NONE);
+		add_monitor(m);
+		add_desktop(m, make_desktop(NULL, XCB_NONE));
+	}
+
+	ewmh_update_number_of_desktops();
+	ewmh_update_desktop_names();
+	ewmh_update_desktop_viewport();
+	ewmh_update_current_desktop();
+}
+
+void schedule_monitors_update(void)
+{
+	uint64_t now = get_time_ns();
+	if (monitors_update_deadline == 0) {
+		monitors_change_start = now;
+	} else {
+		screen_changes_coalesced++;
+	}
+	monitors_update_deadline = MIN(now + (uint64_t) MONITORS_SETTLE_INTERVAL * 1000000,
+	                               monitors_change_start + (uint64_t) MONITORS_SETTLE_MAX * 1000000);
+}
+
+void flush_monitors_update(void)
+{
+	if (monitors_update_deadline == 0 || get_time_ns() < monitors_update_deadline) {
+		return;
+	}
+	monitors_update_deadline = 0;
+	update_monitors();
+	histogram_add(&monitors_settle_latency, (get_time_ns() - monitors_change_start) / 1000);
+}
@@ -27,8 +27,18 @@
 
 #define DEFAULT_MON_NAME     "MONITOR"
 
+/* Screen change notifications are coalesced until none arrived for
+ * MONITORS_SETTLE_INTERVAL milliseconds, or MONITORS_SETTLE_MAX
+ * milliseconds after the first one. */
+#define MONITORS_SETTLE_INTERVAL  100
+#define MONITORS_SETTLE_MAX       1000
+
+extern uint64_t monitors_update_deadline;
+extern uint64_t monitors_change_start;
+
 monitor_t *make_monitor(const char *name, xcb_rectangle_t *rect, uint32_t id);
 void update_root(monitor_t *m, xcb_rectangle_t *rect);
+void create_root(monitor_t *m);
 void reorder_monitor(monitor_t *m);
 void rename_monitor(monitor_t *m, const char *name);
 monitor_t *find_monitor(uint32_t id);
@@ -47,5 +57,8 @@ monitor_t *monitor_from_client(client_t *c);
 monitor_t *nearest_monitor(monitor_t *m, direction_t dir, monitor_select_t *sel);
 bool find_any_monitor(coordinates_t *ref, coordinates_t *dst, monitor_select_t *sel);
 bool update_monitors(void);
+void ensure_monitors(void);
+void schedule_monitors_update(void);
+void flush_monitors_update(void);
 
 #endif
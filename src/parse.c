@@ -282,6 +282,18 @@ bool parse_automatic_scheme(char *s, automatic_scheme_t *a)
 	return false;
 }
 
+bool parse_drag_mode(char *s, drag_mode_t *m)
+{
+	if (streq("live", s)) {
+		*m = DRAG_MODE_LIVE;
+		return true;
+	} else if (streq("outline", s)) {
+		*m = DRAG_MODE_OUTLINE;
+		return true;
+	}
+	return false;
+}
+
 bool parse_state_transition(char *s, state_transition_t *m)
 {
 	if (streq("none", s)) {
@@ -29,12 +29,14 @@
 #include "query.h"
 #include "settings.h"
 #include "stack.h"
+#include "stats.h"
 #include "tree.h"
 #include "monitor.h"
 #include "subscribe.h"
 #include "events.h"
 #include "window.h"
 #include "pointer.h"
+#include "accounting.h"
 
 uint16_t num_lock;
 uint16_t caps_lock;
@@ -42,6 +44,7 @@ uint16_t scroll_lock;
 
 bool grabbing;
 node_t *grabbed_node;
+drag_t drag;
 
 void pointer_init(void)
 {
@@ -258,61 +261,161 @@ bool grab_pointer(pointer_action_t pac)
 	return true;
 }
 
+/* The drag is driven by the main loop: motion events only record the newest
+ * position, which `update_drag` applies at most once per
+ * pointer_motion_interval. In outline mode, only the outline follows the
+ * pointer and the client is configured once, when the drag ends. */
 void track_pointer(coordinates_t loc, pointer_action_t pac, xcb_point_t pos)
 {
-	node_t *n = loc.node;
-	resize_handle_t rh = get_handle(loc.node, pos, pac);
+	drag.loc = loc;
+	drag.action = pac;
+	drag.handle = get_handle(loc.node, pos, pac);
+	drag.mode = pointer_drag_mode;
+	drag.origin = drag.last_position = drag.position = pos;
+	drag.pending = false;
+	drag.next_frame = 0;
+	drag.frames = drag.dropped = 0;
+
+	if (drag.mode == DRAG_MODE_OUTLINE) {
+		xcb_rectangle_t r = get_rectangle(NULL, NULL, loc.node);
+		if (loc.node->client->state != STATE_FULLSCREEN) {
+			r.width += 2 * loc.node->client->border_width;
+			r.height += 2 * loc.node->client->border_width;
+		}
+		drag.rectangle = r;
+		initialize_drag_outline();
+		draw_drag_outline(r);
+	}
 
-	uint16_t last_motion_x = pos.x, last_motion_y = pos.y;
-	xcb_timestamp_t last_motion_time = 0;
+	grabbing = true;
+	grabbed_node = loc.node;
+}
 
-	xcb_generic_event_t *evt = NULL;
+void drag_motion(xcb_motion_notify_event_t *e)
+{
+	if (drag.pending) {
+		drag.dropped++;
+	}
+	drag.position = (xcb_point_t) {e->root_x, e->root_y};
+	drag.pending = true;
+}
 
-	grabbing = true;
-	grabbed_node = n;
+uint64_t drag_deadline(void)
+{
+	if (!grabbing || !drag.pending) {
+		return 0;
+	}
+	return MAX(drag.next_frame, 1);
+}
 
-	do {
-		free(evt);
-		while ((evt = xcb_wait_for_event(dpy)) == NULL) {
-			xcb_flush(dpy);
-		}
-		uint8_t resp_type = XCB_EVENT_RESPONSE_TYPE(evt);
-		if (resp_type == XCB_MOTION_NOTIFY) {
-			xcb_motion_notify_event_t *e = (xcb_motion_notify_event_t*) evt;
-			uint32_t dtime = e->time - last_motion_time;
-			if (dtime < pointer_motion_interval) {
-				continue;
-			}
-			last_motion_time = e->time;
-			int16_t dx = e->root_x - last_motion_x;
-			int16_t dy = e->root_y - last_motion_y;
-			if (pac == ACTION_MOVE) {
-				move_client(&loc, dx, dy);
-			} else {
-				if (honor_size_hints) {
-					resize_client(&loc, rh, e->root_x, e->root_y, false);
-				} else {
-					resize_client(&loc, rh, dx, dy, true);
-				}
-			}
-			last_motion_x = e->root_x;
-			last_motion_y = e->root_y;
-			xcb_flush(dpy);
-		} else if (resp_type == XCB_BUTTON_RELEASE) {
-			grabbing = false;
+void update_drag(void)
+{
+	if (!grabbing) {
+		return;
+	}
+	if (!refresh_drag()) {
+		end_drag();
+		return;
+	}
+	uint64_t now = get_time_ns();
+	if (drag.pending && now >= drag.next_frame) {
+		apply_drag();
+		drag.next_frame = now + (uint64_t) pointer_motion_interval * 1000000;
+	}
+}
+
+/* The grabbed node's monitor and desktop can be removed, or the node sent
+ * elsewhere, by messages received during the drag. */
+bool refresh_drag(void)
+{
+	if (grabbed_node != NULL && (!locate_window(grabbed_node->id, &drag.loc) || drag.loc.node != grabbed_node)) {
+		grabbed_node = NULL;
+	}
+	return (grabbed_node != NULL);
+}
+
+void apply_drag(void)
+{
+	if (drag.mode == DRAG_MODE_OUTLINE) {
+		draw_drag_outline(drag_outline_rectangle());
+		drag.pending = false;
+		drag.frames++;
+		return;
+	}
+	int16_t dx = drag.position.x - drag.last_position.x;
+	int16_t dy = drag.position.y - drag.last_position.y;
+	if (drag.action == ACTION_MOVE) {
+		move_client(&drag.loc, dx, dy);
+	} else {
+		if (honor_size_hints) {
+			resize_client(&drag.loc, drag.handle, drag.position.x, drag.position.y, false);
 		} else {
-			handle_event(evt);
+			resize_client(&drag.loc, drag.handle, dx, dy, true);
 		}
-	} while (grabbing && grabbed_node != NULL);
-	free(evt);
+	}
+	drag.last_position = drag.position;
+	drag.pending = false;
+	drag.frames++;
+}
+
+xcb_rectangle_t drag_outline_rectangle(void)
+{
+	xcb_rectangle_t r = drag.rectangle;
+	int dx = drag.position.x - drag.origin.x;
+	int dy = drag.position.y - drag.origin.y;
+	if (drag.action == ACTION_MOVE) {
+		r.x += dx;
+		r.y += dy;
+		return r;
+	}
+	int w = r.width, h = r.height;
+	if (drag.handle & HANDLE_LEFT) {
+		r.x += MIN(dx, w - 1);
+		w -= dx;
+	} else if (drag.handle & HANDLE_RIGHT) {
+		w += dx;
+	}
+	if (drag.handle & HANDLE_TOP) {
+		r.y += MIN(dy, h - 1);
+		h -= dy;
+	} else if (drag.handle & HANDLE_BOTTOM) {
+		h += dy;
+	}
+	r.width = MAX(1, w);
+	r.height = MAX(1, h);
+	return r;
+}
+
+void end_drag(void)
+{
+	if (drag.mode == DRAG_MODE_OUTLINE) {
+		hide_drag_outline();
+		drag.mode = DRAG_MODE_LIVE;
+		drag.pending = (drag.position.x != drag.last_position.x || drag.position.y != drag.last_position.y);
+	}
+
+	if (refresh_drag() && drag.pending) {
+		apply_drag();
+	}
+
+	grabbing = false;
+
+	drag_count++;
+	drag_frames += drag.frames;
+	drag_dropped += drag.dropped;
+	last_drag_frames = drag.frames;
+	last_drag_dropped = drag.dropped;
 
 	xcb_ungrab_pointer(dpy, XCB_CURRENT_TIME);
 
 	if (grabbed_node == NULL) {
-		grabbing = false;
 		return;
 	}
 
+	coordinates_t loc = drag.loc;
+	pointer_action_t pac = drag.action;
+	node_t *n = loc.node;
+
 	if (pac == ACTION_MOVE) {
 		put_status(SBSC_MASK_POINTER_ACTION, "pointer_action 0x%08X 0x%08X 0x%08X move end\n", loc.monitor->id, loc.desktop->id, n->id);
 	} else if (pac == ACTION_RESIZE_CORNER) {
@@ -35,6 +35,7 @@ extern uint16_t scroll_lock;
 
 extern bool grabbing;
 extern node_t *grabbed_node;
+extern drag_t drag;
 
 void pointer_init(void);
 void window_grab_buttons(xcb_window_t win);
@@ -45,5 +46,12 @@ int16_t modfield_from_keysym(xcb_keysym_t keysym);
 resize_handle_t get_handle(node_t *n, xcb_point_t pos, pointer_action_t pac);
 bool grab_pointer(pointer_action_t pac);
 void track_pointer(coordinates_t loc, pointer_action_t pac, xcb_point_t pos);
+void drag_motion(xcb_motion_notify_event_t *e);
+uint64_t drag_deadline(void);
+void update_drag(void);
+bool refresh_drag(void);
+void apply_drag(void);
+xcb_rectangle_t drag_outline_rectangle(void);
+void end_drag(void);
 
 #endif
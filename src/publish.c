@@ -0,0 +1,272 @@
+/* Copyright (c) 2012, Bastien Dejean
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "bspwm.h"
+#include "common.h"
+#include "tree.h"
+#include "publish.h"
+
+char publish_path[MAXLEN];
+int publish_fd = -1;
+uint8_t *publish_data;
+size_t publish_size;
+uint8_t *publish_buf;
+size_t publish_buf_size;
+
+bool publish_init(void)
+{
+	if (publish_fd != -1) {
+		return true;
+	}
+
+	char *mp = getenv(MIRROR_ENV_VAR);
+	if (mp != NULL) {
+		snprintf(publish_path, sizeof(publish_path), "%s", mp);
+	} else {
+		char *host = NULL;
+		int dn = 0, sn = 0;
+		if (xcb_parse_display(NULL, &host, &dn, &sn) != 0) {
+			snprintf(publish_path, sizeof(publish_path), MIRROR_PATH_TPL, host, dn, sn);
+		}
+		free(host);
+	}
+
+	/* the segment survives restarts: reuse it so that readers keep their mapping */
+	if ((publish_fd = shm_open(publish_path, O_RDWR | O_CREAT, S_IRUSR | S_IWUSR)) == -1) {
+		warn("Can't open the state mirror '%s'.\n", publish_path);
+		return false;
+	}
+
+	struct stat sb;
+	if (fstat(publish_fd, &sb) == -1) {
+		publish_cleanup(true);
+		return false;
+	}
+
+	publish_size = sb.st_size;
+
+	if (publish_size < sizeof(mirror_header_t)) {
+		publish_size = sizeof(mirror_header_t);
+		if (ftruncate(publish_fd, publish_size) == -1) {
+			publish_cleanup(true);
+			return false;
+		}
+	}
+
+	publish_data = mmap(NULL, publish_size, PROT_READ | PROT_WRITE, MAP_SHARED, publish_fd, 0);
+
+	if (publish_data == MAP_FAILED) {
+		publish_data = NULL;
+		publish_cleanup(true);
+		return false;
+	}
+
+	publish_state();
+	return true;
+}
+
+/* Called at the end of each main loop iteration: the segment is only
+ * touched when the state differs from what was last published. */
+void publish_state(void)
+{
+	if (publish_data == NULL) {
+		return;
+	}
+
+	size_t size = fill_mirror(publish_buf, publish_buf_size);
+
+	if (size > publish_buf_size) {
+		uint8_t *buf = realloc(publish_buf, size);
+		if (buf == NULL) {
+			return;
+		}
+		publish_buf = buf;
+		publish_buf_size = size;
+		fill_mirror(publish_buf, publish_buf_size);
+	}
+
+	mirror_header_t *h = (mirror_header_t *) publish_data;
+	mirror_header_t *b = (mirror_header_t *) publish_buf;
+	size_t skip = offsetof(mirror_header_t, size);
+
+	if (h->magic == MIRROR_MAGIC && h->size == size &&
+	    memcmp(publish_data + skip, publish_buf + skip, size - skip) == 0) {
+		return;
+	}
+
+	/* never shrink the segment: readers might have it mapped */
+	if (size > publish_size) {
+		size_t new_size = MAX(size, 2 * publish_size);
+		if (ftruncate(publish_fd, new_size) == -1) {
+			warn("Can't grow the state mirror.\n");
+			return;
+		}
+		uint8_t *data = mmap(NULL, new_size, PROT_READ | PROT_WRITE, MAP_SHARED, publish_fd, 0);
+		if (data == MAP_FAILED) {
+			warn("Can't remap the state mirror.\n");
+			return;
+		}
+		munmap(publish_data, publish_size);
+		publish_data = data;
+		publish_size = new_size;
+		h = (mirror_header_t *) publish_data;
+	}
+
+	uint32_t seq = __atomic_load_n(&h->sequence, __ATOMIC_RELAXED) | 1;
+	__atomic_store_n(&h->sequence, seq, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	h->magic = b->magic;
+	h->version = b->version;
+	h->size = b->size;
+	memcpy(publish_data + skip, publish_buf + skip, size - skip);
+	__atomic_store_n(&h->sequence, seq + 1, __ATOMIC_RELEASE);
+}
+
+void publish_cleanup(bool unlink_segment)
+{
+	if (publish_data != NULL) {
+		mirror_header_t *h = (mirror_header_t *) publish_data;
+		uint32_t seq = __atomic_load_n(&h->sequence, __ATOMIC_RELAXED) | 1;
+		__atomic_store_n(&h->sequence, seq, __ATOMIC_RELAXED);
+		__atomic_thread_fence(__ATOMIC_RELEASE);
+		h->magic = 0;
+		__atomic_store_n(&h->sequence, seq + 1, __ATOMIC_RELEASE);
+		munmap(publish_data, publish_size);
+		publish_data = NULL;
+		publish_size = 0;
+	}
+	if (publish_fd != -1) {
+		close(publish_fd);
+		publish_fd = -1;
+	}
+	if (unlink_segment && publish_path[0] != '\0') {
+		shm_unlink(publish_path);
+	}
+	free(publish_buf);
+	publish_buf = NULL;
+	publish_buf_size = 0;
+}
+
+/* Serializes the state into the given buffer and returns the needed size:
+ * nothing is written if the buffer is too small. */
+size_t fill_mirror(uint8_t *buf, size_t size)
+{
+	uint32_t monitors_count = 0, desktops_count = 0, leaves_count = 0;
+
+	for (monitor_t *m = mon_head; m != NULL; m = m->next) {
+		monitors_count++;
+		for (desktop_t *d = m->desk_head; d != NULL; d = d->next) {
+			desktops_count++;
+			for (node_t *n = first_extrema(d->root); n != NULL; n = next_leaf(n, d->root)) {
+				if (n->client != NULL) {
+					leaves_count++;
+				}
+			}
+		}
+	}
+
+	size_t needed = mirror_size(monitors_count, desktops_count, leaves_count);
+
+	if (buf == NULL || needed > size) {
+		return needed;
+	}
+
+	memset(buf, 0, needed);
+
+	mirror_header_t *h = (mirror_header_t *) buf;
+	h->magic = MIRROR_MAGIC;
+	h->version = MIRROR_VERSION;
+	h->size = needed;
+	h->focused_monitor_id = mon != NULL ? mon->id : 0;
+	h->monitors_count = monitors_count;
+	h->desktops_count = desktops_count;
+	h->leaves_count = leaves_count;
+
+	mirror_monitor_t *mm = (mirror_monitor_t *) mirror_monitors(h);
+	mirror_desktop_t *md = (mirror_desktop_t *) mirror_desktops(h);
+	mirror_leaf_t *ml = (mirror_leaf_t *) mirror_leaves(h);
+
+	for (monitor_t *m = mon_head; m != NULL; m = m->next, mm++) {
+		mm->id = m->id;
+		mm->focused_desktop_id = m->desk != NULL ? m->desk->id : 0;
+		mm->x = m->rectangle.x;
+		mm->y = m->rectangle.y;
+		mm->width = m->rectangle.width;
+		mm->height = m->rectangle.height;
+		copy_name(mm->name, m->name, sizeof(mm->name));
+		for (desktop_t *d = m->desk_head; d != NULL; d = d->next, md++) {
+			mm->desktops_count++;
+			md->id = d->id;
+			md->monitor_id = m->id;
+			md->focused_node_id = d->focus != NULL ? d->focus->id : 0;
+			md->layout = d->layout;
+			copy_name(md->name, d->name, sizeof(md->name));
+			for (node_t *n = first_extrema(d->root); n != NULL; n = next_leaf(n, d->root)) {
+				client_t *c = n->client;
+				if (c == NULL) {
+					continue;
+				}
+				md->leaves_count++;
+				if (c->urgent) {
+					md->urgent = 1;
+				}
+				ml->id = n->id;
+				ml->desktop_id = d->id;
+				ml->x = n->rectangle.x;
+				ml->y = n->rectangle.y;
+				ml->width = n->rectangle.width;
+				ml->height = n->rectangle.height;
+				ml->state = c->state;
+				ml->layer = c->layer;
+				ml->flags = (n->hidden ? MIRROR_LEAF_HIDDEN : 0) |
+				            (n->sticky ? MIRROR_LEAF_STICKY : 0) |
+				            (n->private ? MIRROR_LEAF_PRIVATE : 0) |
+				            (n->locked ? MIRROR_LEAF_LOCKED : 0) |
+				            (n->marked ? MIRROR_LEAF_MARKED : 0) |
+				            (c->urgent ? MIRROR_LEAF_URGENT : 0) |
+				            (c->shown ? MIRROR_LEAF_SHOWN : 0) |
+				            (n == d->focus ? MIRROR_LEAF_FOCUSED : 0);
+				copy_name(ml->class_name, c->class_name, sizeof(ml->class_name));
+				copy_name(ml->instance_name, c->instance_name, sizeof(ml->instance_name));
+				ml++;
+			}
+		}
+	}
+
+	return needed;
+}
+
+void copy_name(char *dst, const char *src, size_t size)
+{
+	size_t len = strnlen(src, size - 1);
+	memcpy(dst, src, len);
+	dst[len] = '\0';
+}
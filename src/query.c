@@ -105,6 +105,7 @@ void query_desktop(desktop_t *d, FILE *rsp)
 	fprintf(rsp, "\"windowGap\":%i,", d->window_gap);
 	fprintf(rsp, "\"borderWidth\":%u,", d->border_width);
 	fprintf(rsp, "\"focusedNodeId\":%u,", d->focus != NULL ? d->focus->id : 0);
+	fprintf(rsp, "\"stale\":%s,", BOOL_STR(d->stale));
 	fprintf(rsp, "\"padding\":");
 	query_padding(d->padding, rsp);
 	fprintf(rsp,",");
@@ -234,7 +235,9 @@ void query_subscribers(FILE *rsp)
 		if (s->fifo_path != NULL) {
 			fprintf(rsp, ",\"fifoPath\":\"%s\"", s->fifo_path);
 		}
-		fprintf(rsp, ",\"field\":%i,\"count\":%i}", s->field, s->count);
+		fprintf(rsp, ",\"field\":%i,\"count\":%i", s->field, s->count);
+		fprintf(rsp, ",\"monitorId\":%u,\"desktopId\":%u,\"nodeId\":%u", s->monitor_id, s->desktop_id, s->node_id);
+		fprintf(rsp, ",\"maxRate\":%u,\"coalesce\":%i,\"coalesced\":%u,\"dropped\":%u}", s->max_rate, s->coalesce, s->coalesced, s->dropped);
 		if (s->next != NULL) {
 			fprintf(rsp, ",");
 		}
@@ -0,0 +1,265 @@
+/* Copyright (c) 2012, Bastien Dejean
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "bspwm.h"
+#include "events.h"
+#include "ewmh.h"
+#include "messages.h"
+#include "monitor.h"
+#include "pointer.h"
+#include "rule.h"
+#include "snapshot.h"
+#include "stats.h"
+#include "subscribe.h"
+#include "window.h"
+#include "record.h"
+
+FILE *recording;
+snapshot_writer_t recording_writer;
+uint64_t recording_origin;
+
+bool record_start(const char *path)
+{
+	if (recording != NULL) {
+		record_stop();
+	}
+
+	recording = fopen(path, "a");
+
+	if (recording == NULL) {
+		warn("Record: can't open '%s'.\n", path);
+		return false;
+	}
+
+	if (fseek(recording, 0, SEEK_END) == 0 && ftell(recording) == 0) {
+		put_bytes(&recording_writer, RECORDING_MAGIC, RECORDING_MAGIC_LEN);
+		put_u16(&recording_writer, RECORDING_VERSION);
+	}
+
+	record_state();
+
+	return recording != NULL;
+}
+
+void record_stop(void)
+{
+	if (recording == NULL) {
+		return;
+	}
+
+	fclose(recording);
+	recording = NULL;
+	free(recording_writer.data);
+	recording_writer = (snapshot_writer_t) {NULL, 0, 0, 0, false};
+}
+
+void record_state(void)
+{
+	snapshot_writer_t s = {NULL, 0, 0, 0, false};
+	write_snapshot(&s);
+
+	if (s.failed) {
+		free(s.data);
+		recording_writer.failed = true;
+		write_recording();
+		return;
+	}
+
+	begin_record(&recording_writer, RECORDING_STATE);
+	put_u32(&recording_writer, root);
+	put_u16(&recording_writer, screen_width);
+	put_u16(&recording_writer, screen_height);
+	put_bytes(&recording_writer, s.data, s.len);
+	end_record(&recording_writer);
+	free(s.data);
+
+	recording_origin = get_time_ns();
+	write_recording();
+}
+
+void record_event(xcb_generic_event_t *evt)
+{
+	begin_record(&recording_writer, RECORDING_EVENT);
+	put_time(&recording_writer);
+	put_bytes(&recording_writer, evt, RECORDING_EVENT_LEN);
+	end_record(&recording_writer);
+	write_recording();
+}
+
+void record_message(char *msg, int msg_len)
+{
+	begin_record(&recording_writer, RECORDING_MESSAGE);
+	put_time(&recording_writer);
+	put_bytes(&recording_writer, msg, msg_len);
+	end_record(&recording_writer);
+	write_recording();
+}
+
+void put_time(snapshot_writer_t *w)
+{
+	uint64_t t = get_time_ns() - recording_origin;
+	put_u32(w, t & 0xFFFFFFFF);
+	put_u32(w, t >> 32);
+}
+
+/* The records are buffered by the stream, hence written in batches. */
+void write_recording(void)
+{
+	if (recording_writer.failed || fwrite(recording_writer.data, 1, recording_writer.len, recording) != recording_writer.len) {
+		warn("Record: can't write the recording, stopping.\n");
+		record_stop();
+		return;
+	}
+	recording_writer.len = 0;
+}
+
+bool replay(const char *path, replay_summary_t *summary)
+{
+	size_t len;
+	char *data = map_file(path, &len);
+
+	if (data == NULL) {
+		return false;
+	}
+
+	if (len < RECORDING_HEADER_LEN || strncmp(data, RECORDING_MAGIC, RECORDING_MAGIC_LEN) != 0) {
+		warn("Replay: invalid header.\n");
+		munmap(data, len);
+		return false;
+	}
+
+	snapshot_reader_t r = {(const uint8_t *) data, RECORDING_MAGIC_LEN, len, len};
+	uint16_t version = get_u16(&r);
+
+	if (version > RECORDING_VERSION) {
+		warn("Replay: version %u is newer than this version, %u.\n", version, RECORDING_VERSION);
+		munmap(data, len);
+		return false;
+	}
+
+	bool ret = true;
+	uint64_t offset = 0;
+	uint64_t start = get_time_ns();
+	snapshot_tag_t tag;
+	r.end = r.pos;
+
+	while (next_record(&r, &tag)) {
+		if (tag == RECORDING_STATE) {
+			root = get_u32(&r);
+			screen_width = get_u16(&r);
+			screen_height = get_u16(&r);
+			if (!restore_snapshot((const char *) r.data + r.pos, r.end - r.pos)) {
+				warn("Replay: invalid state.\n");
+				ret = false;
+				break;
+			}
+			offset = summary->recorded;
+			summary->states++;
+		} else if (summary->states == 0) {
+			warn("Replay: missing state.\n");
+			ret = false;
+			break;
+		} else if (tag == RECORDING_EVENT || tag == RECORDING_MESSAGE) {
+			uint64_t t = get_u32(&r);
+			t |= (uint64_t) get_u32(&r) << 32;
+			summary->recorded = offset + t;
+			if (tag == RECORDING_EVENT) {
+				xcb_generic_event_t evt = {0};
+				get_bytes(&r, &evt, RECORDING_EVENT_LEN);
+				handle_event(&evt);
+				summary->events++;
+			} else {
+				replay_message(&r);
+				summary->messages++;
+			}
+		}
+		finish_replay_step();
+	}
+
+	summary->duration = get_time_ns() - start;
+	munmap(data, len);
+
+	return ret;
+}
+
+/* Subscribers can't wait for a reader on a FIFO: their output is discarded. */
+void replay_message(snapshot_reader_t *r)
+{
+	char msg[BUFSIZ];
+	size_t n = 0;
+	bool subscribe = false;
+
+	while (r->pos < r->end) {
+		const char *arg = (const char *) r->data + r->pos;
+		size_t arg_len = strnlen(arg, r->end - r->pos);
+		r->pos = MIN(r->pos + arg_len + 1, r->end);
+		if (n + arg_len + 1 > sizeof(msg)) {
+			break;
+		}
+		memcpy(msg + n, arg, arg_len);
+		msg[n + arg_len] = '\0';
+		if (n == 0) {
+			subscribe = streq("subscribe", msg);
+		} else if (subscribe && (streq("-f", msg + n) || streq("--fifo", msg + n))) {
+			continue;
+		}
+		n += arg_len + 1;
+	}
+
+	FILE *rsp = fopen("/dev/null", "w");
+
+	if (rsp == NULL) {
+		perror("Replay: fopen");
+		return;
+	}
+
+	handle_message(msg, n, rsp);
+}
+
+/* Mirrors the end of an iteration of the main loop, without publishing the
+ * state, which would overwrite the mirror of the running session. */
+void finish_replay_step(void)
+{
+	expire_pending_rules();
+	update_drag();
+	flush_monitors_update();
+	flush_subscribers(false);
+	prune_dead_subscribers();
+	poll_motion_recorder();
+	ewmh_flush();
+}
+
+void print_replay_summary(replay_summary_t *summary, FILE *rsp)
+{
+	fprintf(rsp, "{\"replay\":{\"states\":%u,\"events\":%u,\"messages\":%u,\"recorded\":%llu,\"duration\":%llu},\"stats\":",
+	        summary->states, summary->events, summary->messages,
+	        (unsigned long long) summary->recorded / 1000, (unsigned long long) summary->duration / 1000);
+	print_stats(rsp);
+	fprintf(rsp, "}\n");
+}
@@ -0,0 +1,76 @@
+/* Copyright (c) 2012, Bastien Dejean
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef BSPWM_RECORD_H
+#define BSPWM_RECORD_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <xcb/xcb.h>
+#include "snapshot.h"
+
+/* A recording starts with a header: the magic string and the version of the
+ * writer. It is followed by records laid out as in snapshots. A state record
+ * holds the root window, the screen size and a snapshot of the world; each
+ * restart appends a new one. Event and message records hold the time elapsed
+ * since the previous state record in nanoseconds, followed by the event or
+ * the message; events are recorded as received, in 32 bytes. */
+
+#define RECORDING_MAGIC       "BSPR"
+#define RECORDING_MAGIC_LEN   4
+#define RECORDING_VERSION     1
+#define RECORDING_HEADER_LEN  (RECORDING_MAGIC_LEN + sizeof(uint16_t))
+#define RECORDING_EVENT_LEN   32
+
+#define RECORDING_STATE    1
+#define RECORDING_EVENT    2
+#define RECORDING_MESSAGE  3
+
+typedef struct {
+	unsigned int states;
+	unsigned int events;
+	unsigned int messages;
+	uint64_t recorded;
+	uint64_t duration;
+} replay_summary_t;
+
+extern FILE *recording;
+extern snapshot_writer_t recording_writer;
+extern uint64_t recording_origin;
+
+bool record_start(const char *path);
+void record_stop(void);
+void record_state(void);
+void record_event(xcb_generic_event_t *evt);
+void record_message(char *msg, int msg_len);
+void put_time(snapshot_writer_t *w);
+void write_recording(void);
+bool replay(const char *path, replay_summary_t *summary);
+void replay_message(snapshot_reader_t *r);
+void finish_replay_step(void);
+void print_replay_summary(replay_summary_t *summary, FILE *rsp);
+
+#endif
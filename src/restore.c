@@ -26,6 +26,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <stdarg.h>
+#include <sys/mman.h>
 #include "bspwm.h"
 #include "desktop.h"
 #include "ewmh.h"
@@ -40,40 +42,43 @@
 #include "restore.h"
 #include "window.h"
 #include "parse.h"
+#include "snapshot.h"
+#include "accounting.h"
 
 bool restore_state(const char *file_path)
 {
 	size_t jslen;
-	char *json = read_string(file_path, &jslen);
+	char *json = map_file(file_path, &jslen);
 
 	if (json == NULL) {
 		return false;
 	}
 
-	int nbtok = 256;
-	jsmn_parser parser;
-	jsmntok_t *tokens = malloc(nbtok * sizeof(jsmntok_t));
-
-	if (tokens == NULL) {
-		perror("Restore tree: malloc");
-		free(json);
-		return false;
+	if (is_snapshot(json, jslen)) {
+		bool ret = restore_snapshot(json, jslen);
+		munmap(json, jslen);
+		return ret;
 	}
 
+	jsmn_parser parser;
+	jsmntok_t *tokens = NULL;
+
+	/* count the tokens first so that the document is tokenized only once */
 	jsmn_init(&parser);
-	int ret;
-
-	while ((ret = jsmn_parse(&parser, json, jslen, tokens, nbtok)) == JSMN_ERROR_NOMEM) {
-		nbtok *= 2;
-		jsmntok_t *rtokens = realloc(tokens, nbtok * sizeof(jsmntok_t));
-		if (rtokens == NULL) {
-			perror("Restore tree: realloc");
-			free(tokens);
-			free(json);
+	int ret = jsmn_parse(&parser, json, jslen, NULL, 0);
+
+	if (ret > 0) {
+		int nbtok = ret;
+		tokens = malloc(nbtok * sizeof(jsmntok_t));
+
+		if (tokens == NULL) {
+			perror("Restore tree: malloc");
+			munmap(json, jslen);
 			return false;
-		} else {
-			tokens = rtokens;
 		}
+
+		jsmn_init(&parser);
+		ret = jsmn_parse(&parser, json, jslen, tokens, nbtok);
 	}
 
 	if (ret < 0) {
@@ -94,16 +99,21 @@ bool restore_state(const char *file_path)
 		}
 
 		free(tokens);
-		free(json);
+		munmap(json, jslen);
 
 		return false;
 	}
 
+	if (ret < 1) {
+		munmap(json, jslen);
+		return false;
+	}
+
 	int num = tokens[0].size;
 
 	if (num < 1) {
 		free(tokens);
-		free(json);
+		munmap(json, jslen);
 
 		return false;
 	}
@@ -120,13 +130,13 @@ bool restore_state(const char *file_path)
 	for (int i = 0; i < num; i++) {
 		if (keyeq("focusedMonitorId", t, json)) {
 			t++;
-			sscanf(json + t->start, "%u", &focused_monitor_id);
+			tokscanf(t, json, "%u", &focused_monitor_id);
 		} else if (keyeq("primaryMonitorId", t, json)) {
 			t++;
-			sscanf(json + t->start, "%u", &primary_monitor_id);
+			tokscanf(t, json, "%u", &primary_monitor_id);
 		} else if (keyeq("clientsCount", t, json)) {
 			t++;
-			sscanf(json + t->start, "%u", &clients_count);
+			tokscanf(t, json, "%u", &clients_count);
 		} else if (keyeq("monitors", t, json)) {
 			t++;
 			int s = t->size;
@@ -175,6 +185,8 @@ bool restore_state(const char *file_path)
 		}
 	}
 
+	ensure_monitors();
+
 	if (focus_history_token != NULL) {
 		restore_history(&focus_history_token, json);
 	}
@@ -183,6 +195,16 @@ bool restore_state(const char *file_path)
 		restore_stack(&stacking_list_token, json);
 	}
 
+	restore_windows();
+
+	free(tokens);
+	munmap(json, jslen);
+
+	return true;
+}
+
+void restore_windows(void)
+{
 	for (monitor_t *m = mon_head; m != NULL; m = m->next) {
 		m->id = xcb_generate_id(dpy);
 		for (desktop_t *d = m->desk_head; d != NULL; d = d->next) {
@@ -195,7 +217,9 @@ bool restore_state(const char *file_path)
 				if (n->client == NULL) {
 					continue;
 				}
-				initialize_client(n);
+				window_props_t wp = {0};
+				fetch_client_props(n->id, &wp);
+				initialize_client(n, &wp);
 				uint32_t values[] = {CLIENT_EVENT_MASK | (focus_follows_pointer ? XCB_EVENT_MASK_ENTER_WINDOW : 0)};
 				xcb_change_window_attributes(dpy, n->id, XCB_CW_EVENT_MASK, values);
 				window_grab_buttons(n->id);
@@ -210,32 +234,27 @@ bool restore_state(const char *file_path)
 	ewmh_update_client_list(false);
 	ewmh_update_client_list(true);
 	ewmh_update_active_window();
-
-	free(tokens);
-	free(json);
-
-	return true;
 }
 
 #define RESTORE_INT(k, p) \
 	} else if (keyeq(#k, *t, json)) { \
 		(*t)++; \
-		sscanf(json + (*t)->start, "%i", p);
+		tokscanf(*t, json, "%i", p);
 
 #define RESTORE_UINT(k, p) \
 	} else if (keyeq(#k, *t, json)) { \
 		(*t)++; \
-		sscanf(json + (*t)->start, "%u", p);
+		tokscanf(*t, json, "%u", p);
 
 #define RESTORE_USINT(k, p) \
 	} else if (keyeq(#k, *t, json)) { \
 		(*t)++; \
-		sscanf(json + (*t)->start, "%hu", p);
+		tokscanf(*t, json, "%hu", p);
 
 #define RESTORE_DOUBLE(k, p) \
 	} else if (keyeq(#k, *t, json)) { \
 		(*t)++; \
-		sscanf(json + (*t)->start, "%lf", p);
+		tokscanf(*t, json, "%lf", p);
 
 #define RESTORE_ANY(k, p, f) \
 	} else if (keyeq(#k, *t, json)) { \
@@ -256,7 +275,7 @@ monitor_t *restore_monitor(jsmntok_t **t, char *json)
 	for (int i = 0; i < num; i++) {
 		if (keyeq("name", *t, json)) {
 			(*t)++;
-			snprintf(m->name, (*t)->end - (*t)->start + 1, "%s", json + (*t)->start);
+			snprintf(m->name, sizeof(m->name), "%.*s", (*t)->end - (*t)->start, json + (*t)->start);
 		RESTORE_UINT(id, &m->id)
 		RESTORE_UINT(randrId, &m->randr_id)
 		RESTORE_BOOL(wired, &m->wired)
@@ -311,7 +330,7 @@ desktop_t *restore_desktop(jsmntok_t **t, char *json)
 	for (int i = 0; i < s; i++) {
 		if (keyeq("name", *t, json)) {
 			(*t)++;
-			snprintf(d->name, (*t)->end - (*t)->start + 1, "%s", json + (*t)->start);
+			snprintf(d->name, sizeof(d->name), "%.*s", (*t)->end - (*t)->start, json + (*t)->start);
 		RESTORE_UINT(id, &d->id)
 		RESTORE_ANY(layout, &d->layout, parse_layout)
 		RESTORE_ANY(userLayout, &d->user_layout, parse_layout)
@@ -319,7 +338,8 @@ desktop_t *restore_desktop(jsmntok_t **t, char *json)
 		RESTORE_UINT(borderWidth, &d->border_width)
 		} else if (keyeq("focusedNodeId", *t, json)) {
 			(*t)++;
-			sscanf(json + (*t)->start, "%u", &focusedNodeId);
+			tokscanf(*t, json, "%u", &focusedNodeId);
+		RESTORE_BOOL(stale, &d->stale)
 		} else if (keyeq("padding", *t, json)) {
 			(*t)++;
 			restore_padding(&d->padding, t, json);
@@ -356,7 +376,7 @@ node_t *restore_node(jsmntok_t **t, char *json)
 		for (int i = 0; i < s; i++) {
 			if (keyeq("id", *t, json)) {
 				(*t)++;
-				sscanf(json + (*t)->start, "%u", &n->id);
+				tokscanf(*t, json, "%u", &n->id);
 			RESTORE_ANY(splitType, &n->split_type, parse_split_type)
 			RESTORE_DOUBLE(splitRatio, &n->split_ratio)
 			RESTORE_BOOL(vacant, &n->vacant)
@@ -421,7 +441,7 @@ presel_t *restore_presel(jsmntok_t **t, char *json)
 		for (int i = 0; i < s; i++) {
 			if (keyeq("splitRatio", *t, json)) {
 				(*t)++;
-				sscanf(json + (*t)->start, "%lf", &p->split_ratio);
+				tokscanf(*t, json, "%lf", &p->split_ratio);
 			RESTORE_ANY(splitDir, &p->split_dir, parse_direction)
 			}
 
@@ -446,10 +466,10 @@ client_t *restore_client(jsmntok_t **t, char *json)
 		for (int i = 0; i < s; i++) {
 			if (keyeq("className", *t, json)) {
 				(*t)++;
-				snprintf(c->class_name, (*t)->end - (*t)->start + 1, "%s", json + (*t)->start);
+				snprintf(c->class_name, sizeof(c->class_name), "%.*s", (*t)->end - (*t)->start, json + (*t)->start);
 			} else if (keyeq("instanceName", *t, json)) {
 				(*t)++;
-				snprintf(c->instance_name, (*t)->end - (*t)->start + 1, "%s", json + (*t)->start);
+				snprintf(c->instance_name, sizeof(c->instance_name), "%.*s", (*t)->end - (*t)->start, json + (*t)->start);
 			RESTORE_ANY(state, &c->state, parse_client_state)
 			RESTORE_ANY(lastState, &c->last_state, parse_client_state)
 			RESTORE_ANY(layer, &c->layer, parse_stack_layer)
@@ -485,16 +505,16 @@ void restore_rectangle(xcb_rectangle_t *r, jsmntok_t **t, char *json)
 	for (int i = 0; i < s; i++) {
 		if (keyeq("x", *t, json)) {
 			(*t)++;
-			sscanf(json + (*t)->start, "%hi", &r->x);
+			tokscanf(*t, json, "%hi", &r->x);
 		} else if (keyeq("y", *t, json)) {
 			(*t)++;
-			sscanf(json + (*t)->start, "%hi", &r->y);
+			tokscanf(*t, json, "%hi", &r->y);
 		} else if (keyeq("width", *t, json)) {
 			(*t)++;
-			sscanf(json + (*t)->start, "%hu", &r->width);
+			tokscanf(*t, json, "%hu", &r->width);
 		} else if (keyeq("height", *t, json)) {
 			(*t)++;
-			sscanf(json + (*t)->start, "%hu", &r->height);
+			tokscanf(*t, json, "%hu", &r->height);
 		}
 		(*t)++;
 	}
@@ -508,10 +528,10 @@ void restore_constraints(constraints_t *c, jsmntok_t **t, char *json)
 	for (int i = 0; i < s; i++) {
 		if (keyeq("min_width", *t, json)) {
 			(*t)++;
-			sscanf(json + (*t)->start, "%hu", &c->min_width);
+			tokscanf(*t, json, "%hu", &c->min_width);
 		} else if (keyeq("min_height", *t, json)) {
 			(*t)++;
-			sscanf(json + (*t)->start, "%hu", &c->min_height);
+			tokscanf(*t, json, "%hu", &c->min_height);
 		}
 		(*t)++;
 	}
@@ -525,16 +545,16 @@ void restore_padding(padding_t *p, jsmntok_t **t, char *json)
 	for (int i = 0; i < s; i++) {
 		if (keyeq("top", *t, json)) {
 			(*t)++;
-			sscanf(json + (*t)->start, "%i", &p->top);
+			tokscanf(*t, json, "%i", &p->top);
 		} else if (keyeq("right", *t, json)) {
 			(*t)++;
-			sscanf(json + (*t)->start, "%i", &p->right);
+			tokscanf(*t, json, "%i", &p->right);
 		} else if (keyeq("bottom", *t, json)) {
 			(*t)++;
-			sscanf(json + (*t)->start, "%i", &p->bottom);
+			tokscanf(*t, json, "%i", &p->bottom);
 		} else if (keyeq("left", *t, json)) {
 			(*t)++;
-			sscanf(json + (*t)->start, "%i", &p->left);
+			tokscanf(*t, json, "%i", &p->left);
 		}
 		(*t)++;
 	}
@@ -575,7 +595,7 @@ void restore_subscriber(subscriber_list_t *s, jsmntok_t **t, char *json)
 		if (keyeq("fileDescriptor", *t, json)) {
 			(*t)++;
 			int fd;
-			sscanf(json + (*t)->start, "%i", &fd);
+			tokscanf(*t, json, "%i", &fd);
 			s->stream = fdopen(fd, "w");
 		} else if (keyeq("fifoPath", *t, json)) {
 			(*t)++;
@@ -583,6 +603,13 @@ void restore_subscriber(subscriber_list_t *s, jsmntok_t **t, char *json)
 			s->fifo_path = copy_string(json + (*t)->start, (*t)->end - (*t)->start);
 		RESTORE_INT(field, &s->field)
 		RESTORE_INT(count, &s->count)
+		RESTORE_UINT(monitorId, &s->monitor_id)
+		RESTORE_UINT(desktopId, &s->desktop_id)
+		RESTORE_UINT(nodeId, &s->node_id)
+		RESTORE_UINT(maxRate, &s->max_rate)
+		RESTORE_INT(coalesce, &s->coalesce)
+		RESTORE_UINT(coalesced, &s->coalesced)
+		RESTORE_UINT(dropped, &s->dropped)
 		}
 		(*t)++;
 	}
@@ -597,15 +624,15 @@ void restore_coordinates(coordinates_t *loc, jsmntok_t **t, char *json)
 	for (int i = 0; i < s; i++) {
 		if (keyeq("monitorId", *t, json)) {
 			(*t)++;
-			sscanf(json + (*t)->start, "%u", &id);
+			tokscanf(*t, json, "%u", &id);
 			loc->monitor = find_monitor(id);
 		} else if (keyeq("desktopId", *t, json)) {
 			(*t)++;
-			sscanf(json + (*t)->start, "%u", &id);
+			tokscanf(*t, json, "%u", &id);
 			loc->desktop = find_desktop_in(id, loc->monitor);
 		} else if (keyeq("nodeId", *t, json)) {
 			(*t)++;
-			sscanf(json + (*t)->start, "%u", &id);
+			tokscanf(*t, json, "%u", &id);
 			loc->node = find_by_id_in(loc->desktop != NULL ? loc->desktop->root : NULL, id);
 		}
 		(*t)++;
@@ -619,7 +646,7 @@ void restore_stack(jsmntok_t **t, char *json)
 
 	for (int i = 0; i < s; i++) {
 		uint32_t id;
-		sscanf(json + (*t)->start, "%u", &id);
+		tokscanf(*t, json, "%u", &id);
 		coordinates_t loc;
 		if (locate_window(id, &loc)) {
 			stack_insert_after(stack_tail, loc.node);
@@ -635,6 +662,18 @@ void restore_stack(jsmntok_t **t, char *json)
 #undef RESTORE_ANY
 #undef RESTORE_BOOL
 
+int tokscanf(jsmntok_t *t, char *json, const char *fmt, ...)
+{
+	/* the document isn't null-terminated: scan a bounded copy of the token */
+	char buf[SMALEN];
+	snprintf(buf, sizeof(buf), "%.*s", t->end - t->start, json + t->start);
+	va_list ap;
+	va_start(ap, fmt);
+	int ret = vsscanf(buf, fmt, ap);
+	va_end(ap);
+	return ret;
+}
+
 bool keyeq(char *s, jsmntok_t *key, char *json)
 {
 	size_t n = key->end - key->start;
@@ -28,6 +28,7 @@
 #include "jsmn.h"
 
 bool restore_state(const char *file_path);
+void restore_windows(void);
 monitor_t *restore_monitor(jsmntok_t **t, char *json);
 desktop_t *restore_desktop(jsmntok_t **t, char *json);
 node_t *restore_node(jsmntok_t **t, char *json);
@@ -41,6 +42,7 @@ void restore_subscribers(jsmntok_t **t, char *json);
 void restore_subscriber(subscriber_list_t *s, jsmntok_t **t, char *json);
 void restore_coordinates(coordinates_t *loc, jsmntok_t **t, char *json);
 void restore_stack(jsmntok_t **t, char *json);
+int tokscanf(jsmntok_t *t, char *json, const char *fmt, ...);
 bool keyeq(char *s, jsmntok_t *key, char *json);
 
 #endif
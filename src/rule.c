@@ -28,13 +28,22 @@
 #include <sys/types.h>
 #include <string.h>
 #include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <fnmatch.h>
 #include "bspwm.h"
 #include "ewmh.h"
+#include "events.h"
 #include "window.h"
 #include "query.h"
 #include "parse.h"
 #include "settings.h"
+#include "stats.h"
 #include "rule.h"
+#include "accounting.h"
 
 rule_t *make_rule(void)
 {
@@ -45,8 +54,26 @@ rule_t *make_rule(void)
 	return r;
 }
 
-void add_rule(rule_t *r)
- {
+bool add_rule(rule_t *r)
+{
+	if (!compile_pattern(r->class_name, &r->class_pattern)) {
+		return false;
+	}
+	if (!compile_pattern(r->instance_name, &r->instance_pattern)) {
+		free_pattern(&r->class_pattern);
+		return false;
+	}
+	if (!compile_pattern(r->name, &r->name_pattern)) {
+		free_pattern(&r->class_pattern);
+		free_pattern(&r->instance_pattern);
+		return false;
+	}
+	if (!index_rule(r)) {
+		free_pattern(&r->class_pattern);
+		free_pattern(&r->instance_pattern);
+		free_pattern(&r->name_pattern);
+		return false;
+	}
 	if (rule_head == NULL) {
 		rule_head = rule_tail = r;
 	} else {
@@ -54,6 +81,8 @@ void add_rule(rule_t *r)
 		r->prev = rule_tail;
 		rule_tail = r;
 	}
+	parse_rule_delta(r->effect, &r->delta);
+	return true;
 }
 
 void remove_rule(rule_t *r)
@@ -75,6 +104,11 @@ void remove_rule(rule_t *r)
 	if (r == rule_tail) {
 		rule_tail = prev;
 	}
+	unindex_rule(r);
+	free_rule_delta(&r->delta);
+	free_pattern(&r->class_pattern);
+	free_pattern(&r->instance_pattern);
+	free_pattern(&r->name_pattern);
 	free(r);
 }
 
@@ -133,8 +167,13 @@ pending_rule_t *make_pending_rule(int fd, xcb_window_t win, rule_consequence_t *
 	pr->prev = pr->next = NULL;
 	pr->event_head = pr->event_tail = NULL;
 	pr->fd = fd;
+	pr->pid = -1;
 	pr->win = win;
 	pr->csq = csq;
+	pr->buf = NULL;
+	pr->len = pr->size = 0;
+	pr->started = get_time_ns();
+	pr->deadline = external_rules_timeout > 0 ? pr->started + (uint64_t) external_rules_timeout * 1000000 : 0;
 	return pr;
 }
 
@@ -171,7 +210,10 @@ void remove_pending_rule(pending_rule_t *pr)
 	if (pr == pending_rule_tail) {
 		pending_rule_tail = a;
 	}
-	close(pr->fd);
+	if (pr->fd != -1) {
+		close(pr->fd);
+	}
+	free(pr->buf);
 	free(pr->csq);
 	event_queue_t *eq = pr->event_head;
 	while (eq != NULL) {
@@ -227,10 +269,12 @@ event_queue_t *make_event_queue(xcb_generic_event_t *evt)
 		*(csq->layer) = (val); \
 	} while (0)
 
-void _apply_window_type(xcb_window_t win, rule_consequence_t *csq)
+void _apply_window_type(xcb_window_t win, window_props_t *wp, rule_consequence_t *csq)
 {
 	xcb_ewmh_get_atoms_reply_t win_type;
-	if (xcb_ewmh_get_wm_window_type_reply(ewmh, xcb_ewmh_get_wm_window_type(ewmh, win), &win_type, NULL) == 1) {
+	int ok = xcb_ewmh_get_wm_window_type_reply(ewmh, wp->window_type, &win_type, NULL);
+	wp->window_type.sequence = 0;
+	if (ok == 1) {
 		for (unsigned int i = 0; i < win_type.atoms_len; i++) {
 			xcb_atom_t a = win_type.atoms[i];
 			if (a == ewmh->_NET_WM_WINDOW_TYPE_TOOLBAR ||
@@ -252,10 +296,12 @@ void _apply_window_type(xcb_window_t win, rule_consequence_t *csq)
 	}
 }
 
-void _apply_window_state(xcb_window_t win, rule_consequence_t *csq)
+void _apply_window_state(window_props_t *wp, rule_consequence_t *csq)
 {
 	xcb_ewmh_get_atoms_reply_t win_state;
-	if (xcb_ewmh_get_wm_state_reply(ewmh, xcb_ewmh_get_wm_state(ewmh, win), &win_state, NULL) == 1) {
+	int ok = xcb_ewmh_get_wm_state_reply(ewmh, wp->window_state, &win_state, NULL);
+	wp->window_state.sequence = 0;
+	if (ok == 1) {
 		for (unsigned int i = 0; i < win_state.atoms_len; i++) {
 			xcb_atom_t a = win_state.atoms[i];
 			if (a == ewmh->_NET_WM_STATE_FULLSCREEN) {
@@ -272,19 +318,22 @@ void _apply_window_state(xcb_window_t win, rule_consequence_t *csq)
 	}
 }
 
-void _apply_transient(xcb_window_t win, rule_consequence_t *csq)
+void _apply_transient(window_props_t *wp, rule_consequence_t *csq)
 {
 	xcb_window_t transient_for = XCB_NONE;
-	xcb_icccm_get_wm_transient_for_reply(dpy, xcb_icccm_get_wm_transient_for(dpy, win), &transient_for, NULL);
+	xcb_icccm_get_wm_transient_for_reply(dpy, wp->transient_for, &transient_for, NULL);
+	wp->transient_for.sequence = 0;
 	if (transient_for != XCB_NONE) {
 		SET_CSQ_STATE(STATE_FLOATING);
 	}
 }
 
-void _apply_hints(xcb_window_t win, rule_consequence_t *csq)
+void _apply_hints(window_props_t *wp, rule_consequence_t *csq)
 {
 	xcb_size_hints_t size_hints;
-	if (xcb_icccm_get_wm_normal_hints_reply(dpy, xcb_icccm_get_wm_normal_hints(dpy, win), &size_hints, NULL) == 1) {
+	int ok = xcb_icccm_get_wm_normal_hints_reply(dpy, wp->size_hints, &size_hints, NULL);
+	wp->size_hints.sequence = 0;
+	if (ok == 1) {
 		if ((size_hints.flags & (XCB_ICCCM_SIZE_HINT_P_MIN_SIZE | XCB_ICCCM_SIZE_HINT_P_MAX_SIZE)) &&
 		    size_hints.min_width == size_hints.max_width && size_hints.min_height == size_hints.max_height) {
 			SET_CSQ_STATE(STATE_FLOATING);
@@ -292,20 +341,24 @@ void _apply_hints(xcb_window_t win, rule_consequence_t *csq)
 	}
 }
 
-void _apply_class(xcb_window_t win, rule_consequence_t *csq)
+void _apply_class(window_props_t *wp, rule_consequence_t *csq)
 {
 	xcb_icccm_get_wm_class_reply_t reply;
-	if (xcb_icccm_get_wm_class_reply(dpy, xcb_icccm_get_wm_class(dpy, win), &reply, NULL) == 1) {
+	int ok = xcb_icccm_get_wm_class_reply(dpy, wp->class, &reply, NULL);
+	wp->class.sequence = 0;
+	if (ok == 1) {
 		snprintf(csq->class_name, sizeof(csq->class_name), "%s", reply.class_name);
 		snprintf(csq->instance_name, sizeof(csq->instance_name), "%s", reply.instance_name);
 		xcb_icccm_get_wm_class_reply_wipe(&reply);
 	}
 }
 
-void _apply_name(xcb_window_t win, rule_consequence_t *csq)
+void _apply_name(window_props_t *wp, rule_consequence_t *csq)
 {
 	xcb_icccm_get_text_property_reply_t reply;
-	if (xcb_icccm_get_wm_name_reply(dpy, xcb_icccm_get_wm_name(dpy, win), &reply, NULL) == 1) {
+	int ok = xcb_icccm_get_wm_name_reply(dpy, wp->name, &reply, NULL);
+	wp->name.sequence = 0;
+	if (ok == 1) {
 		snprintf(csq->name, sizeof(csq->name), "%s", reply.name);
 		xcb_icccm_get_text_property_reply_wipe(&reply);
 	}
@@ -322,39 +375,79 @@ void parse_keys_values(char *buf, rule_consequence_t *csq)
 	}
 }
 
-void apply_rules(xcb_window_t win, rule_consequence_t *csq)
+void apply_rules(xcb_window_t win, window_props_t *wp, rule_consequence_t *csq)
 {
-	_apply_window_type(win, csq);
-	_apply_window_state(win, csq);
-	_apply_transient(win, csq);
-	_apply_hints(win, csq);
-	_apply_class(win, csq);
-	_apply_name(win, csq);
+	_apply_window_type(win, wp, csq);
+	_apply_window_state(wp, csq);
+	_apply_transient(wp, csq);
+	_apply_hints(wp, csq);
+	_apply_class(wp, csq);
+	_apply_name(wp, csq);
+
+	/* the candidates are the exact and wildcard buckets, merged in insertion
+	 * order: patterns are indexed as wildcards */
+	rule_bucket_t *buckets[] = {
+		find_rule_bucket(csq->class_name, csq->instance_name),
+		find_rule_bucket(csq->class_name, MATCH_ANY),
+		find_rule_bucket(MATCH_ANY, csq->instance_name),
+		find_rule_bucket(MATCH_ANY, MATCH_ANY)
+	};
+	size_t pos[] = {0, 0, 0, 0};
+	int len = sizeof(buckets) / sizeof(buckets[0]);
 
-	rule_t *rule = rule_head;
-	while (rule != NULL) {
-		rule_t *next = rule->next;
-		if ((streq(rule->class_name, MATCH_ANY) || streq(rule->class_name, csq->class_name)) &&
-		    (streq(rule->instance_name, MATCH_ANY) || streq(rule->instance_name, csq->instance_name)) &&
-		    (streq(rule->name, MATCH_ANY) || streq(rule->name, csq->name))) {
-			char effect[MAXLEN];
-			snprintf(effect, sizeof(effect), "%s", rule->effect);
-			parse_keys_values(effect, csq);
+	for (int i = 1; i < len; i++) {
+		for (int j = 0; j < i; j++) {
+			if (buckets[i] == buckets[j]) {
+				buckets[i] = NULL;
+			}
+		}
+	}
+
+	while (true) {
+		rule_t *rule = NULL;
+		int k = -1;
+		for (int i = 0; i < len; i++) {
+			if (buckets[i] != NULL && pos[i] < buckets[i]->len &&
+			    (rule == NULL || buckets[i]->rules[pos[i]]->seq < rule->seq)) {
+				rule = buckets[i]->rules[pos[i]];
+				k = i;
+			}
+		}
+		if (rule == NULL) {
+			break;
+		}
+		pos[k]++;
+		if (pattern_matches(&rule->class_pattern, rule->class_name, csq->class_name) &&
+		    pattern_matches(&rule->instance_pattern, rule->instance_name, csq->instance_name) &&
+		    pattern_matches(&rule->name_pattern, rule->name, csq->name)) {
+			rule->hits++;
+			apply_rule_delta(&rule->delta, csq);
 			if (rule->one_shot) {
 				remove_rule(rule);
 				break;
 			}
 		}
-		rule = next;
 	}
 }
 
 bool schedule_rules(xcb_window_t win, rule_consequence_t *csq)
 {
 	if (external_rules_command[0] == '\0') {
+		stop_rules_daemon();
 		return false;
 	}
 	resolve_rule_consequence(csq);
+	if (external_rules_daemon) {
+		pending_rule_t *pr = make_pending_rule(-1, win, csq);
+		pr->request_id = rules_daemon.next_id++;
+		if (send_rule_request(pr)) {
+			add_pending_rule(pr);
+			return true;
+		}
+		free(pr);
+		return false;
+	}
+	stop_rules_daemon();
 	int fds[2];
 	if (pipe(fds) == -1) {
 		return false;
@@ -376,90 +469,625 @@ bool schedule_rules(xcb_window_t win, rule_consequence_t *csq)
 		err("Couldn't spawn rule command.\n");
 	} else if (pid > 0) {
 		close(fds[1]);
+		fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+		fcntl(fds[0], F_SETFL, O_NONBLOCK | fcntl(fds[0], F_GETFL));
 		pending_rule_t *pr = make_pending_rule(fds[0], win, csq);
+		pr->pid = pid;
 		add_pending_rule(pr);
 	}
 	return (pid != -1);
 }
 
-void parse_rule_consequence(int fd, rule_consequence_t *csq)
+/* Returns true when the output of the command is complete. */
+bool read_pending_rule(pending_rule_t *pr)
+{
+	if (pr->size - pr->len < BUFSIZ) {
+		size_t size = pr->len + 2 * BUFSIZ;
+		char *buf = realloc(pr->buf, size);
+		if (buf == NULL) {
+			warn("Read pending rule: can't grow the buffer.\n");
+			return true;
+		}
+		pr->buf = buf;
+		pr->size = size;
+	}
+	ssize_t nb = read(pr->fd, pr->buf + pr->len, pr->size - pr->len - 1);
+	if (nb > 0) {
+		pr->len += nb;
+		return false;
+	}
+	return (nb == 0 || (errno != EAGAIN && errno != EINTR));
+}
+
+void finish_pending_rule(pending_rule_t *pr)
+{
+	if (pr->buf != NULL) {
+		pr->buf[pr->len] = '\0';
+		parse_keys_values(pr->buf, pr->csq);
+	}
+	histogram_add(&external_rules_latency, (get_time_ns() - pr->started) / 1000);
+	window_props_t wp = {0};
+	fetch_manage_props(pr->win, &wp);
+	if (manage_window(pr->win, &wp, pr->csq)) {
+		for (event_queue_t *eq = pr->event_head; eq != NULL; eq = eq->next) {
+			handle_event(&eq->event);
+		}
+	}
+	remove_pending_rule(pr);
+}
+
+bool start_rules_daemon(void)
 {
-	if (fd == -1) {
+	if (rules_daemon.pid != -1 && streq(rules_daemon.command, external_rules_command)) {
+		return true;
+	}
+	stop_rules_daemon();
+	int in[2], out[2];
+	if (pipe(in) == -1) {
+		return false;
+	}
+	if (pipe(out) == -1) {
+		close(in[0]);
+		close(in[1]);
+		return false;
+	}
+	pid_t pid = fork();
+	if (pid == 0) {
+		if (dpy != NULL) {
+			close(xcb_get_file_descriptor(dpy));
+		}
+		dup2(in[0], 0);
+		dup2(out[1], 1);
+		close(in[0]);
+		close(in[1]);
+		close(out[0]);
+		close(out[1]);
+		setsid();
+		execl(external_rules_command, external_rules_command, NULL);
+		err("Couldn't spawn the external rules daemon.\n");
+	}
+	close(in[0]);
+	close(out[1]);
+	if (pid == -1) {
+		close(in[1]);
+		close(out[0]);
+		return false;
+	}
+	fcntl(in[1], F_SETFD, FD_CLOEXEC);
+	fcntl(out[0], F_SETFD, FD_CLOEXEC);
+	fcntl(in[1], F_SETFL, O_NONBLOCK | fcntl(in[1], F_GETFL));
+	rules_daemon.pid = pid;
+	rules_daemon.in_fd = in[1];
+	rules_daemon.out_fd = out[0];
+	rules_daemon.len = 0;
+	snprintf(rules_daemon.command, sizeof(rules_daemon.command), "%s", external_rules_command);
+	return true;
+}
+
+void stop_rules_daemon(void)
+{
+	if (rules_daemon.pid == -1) {
 		return;
 	}
-	char data[BUFSIZ];
-	int nb;
-	while ((nb = read(fd, data, sizeof(data))) > 0) {
-		int end = MIN(nb, (int) sizeof(data) - 1);
-		data[end] = '\0';
-		parse_keys_values(data, csq);
+	close(rules_daemon.in_fd);
+	close(rules_daemon.out_fd);
+	if (waitpid(rules_daemon.pid, NULL, WNOHANG) == 0) {
+		kill(rules_daemon.pid, SIGTERM);
 	}
+	free(rules_daemon.buf);
+	rules_daemon = (rules_daemon_t) {.pid = -1, .in_fd = -1, .out_fd = -1, .next_id = rules_daemon.next_id};
+}
+
+/* A request is the length of its payload followed by a newline and the
+ * payload: the request id, the window id, the class name, the instance name
+ * and the consequence, separated by newlines. Requests are shorter than
+ * PIPE_BUF, hence written atomically. */
+bool send_rule_request(pending_rule_t *pr)
+{
+	char *csq_buf, *payload, *frame;
+	print_rule_consequence(&csq_buf, pr->csq);
+	int len = asprintf(&payload, "%u\n%i\n%s\n%s\n%s", pr->request_id, pr->win, pr->csq->class_name, pr->csq->instance_name, csq_buf);
+	free(csq_buf);
+	if (len == -1) {
+		return false;
+	}
+	int flen = asprintf(&frame, "%i\n%s", len, payload);
+	free(payload);
+	if (flen == -1) {
+		return false;
+	}
+	bool success = false;
+	if (flen < PIPE_BUF) {
+		for (int attempts = 0; attempts < 2 && !success; attempts++) {
+			if (!start_rules_daemon()) {
+				break;
+			}
+			if (write(rules_daemon.in_fd, frame, flen) == flen) {
+				success = true;
+			} else if (errno == EPIPE) {
+				stop_rules_daemon();
+			} else {
+				break;
+			}
+		}
+	}
+	free(frame);
+	return success;
+}
+
+/* The requests waiting for the daemon are sent again, or applied with the
+ * consequences received so far. */
+void drop_rules_daemon(bool respawn)
+{
+	stop_rules_daemon();
+	pending_rule_t *pr = pending_rule_head;
+	while (pr != NULL) {
+		pending_rule_t *next = pr->next;
+		if (pr->fd == -1 && (!respawn || !send_rule_request(pr))) {
+			finish_pending_rule(pr);
+		}
+		pr = next;
+	}
+}
+
+/* A response is framed like a request, its payload is the request id followed
+ * by a newline and the keys and values of the consequence. */
+void handle_rules_daemon(void)
+{
+	if (rules_daemon.size - rules_daemon.len < BUFSIZ) {
+		size_t size = rules_daemon.len + 2 * BUFSIZ;
+		char *buf = realloc(rules_daemon.buf, size);
+		if (buf == NULL) {
+			warn("Can't grow the buffer of the external rules daemon, stopping it.\n");
+			drop_rules_daemon(false);
+			return;
+		}
+		rules_daemon.buf = buf;
+		rules_daemon.size = size;
+	}
+
+	ssize_t nb = read(rules_daemon.out_fd, rules_daemon.buf + rules_daemon.len, rules_daemon.size - rules_daemon.len - 1);
+
+	if (nb <= 0) {
+		/* only restart a daemon that used to work */
+		bool respawn = rules_daemon.answered;
+		warn("The external rules daemon died%s.\n", respawn ? ", restarting it" : "");
+		drop_rules_daemon(respawn);
+		return;
+	}
+
+	rules_daemon.len += nb;
+
+	char *pos = rules_daemon.buf;
+	char *end = rules_daemon.buf + rules_daemon.len;
+
+	while (pos < end) {
+		char *nl = memchr(pos, '\n', end - pos);
+		if (nl == NULL) {
+			break;
+		}
+		char *e;
+		long len = strtol(pos, &e, 10);
+		if (e != nl || len < 0) {
+			warn("The external rules daemon sent an invalid response.\n");
+			rules_daemon.len = 0;
+			return;
+		}
+		if (end - (nl + 1) < len) {
+			break;
+		}
+		char *payload = copy_string(nl + 1, len);
+		pos = nl + 1 + len;
+		uint32_t id;
+		int n;
+		if (payload != NULL && sscanf(payload, "%u%n", &id, &n) == 1) {
+			pending_rule_t *pr = find_pending_rule(id);
+			rules_daemon.answered = true;
+			if (pr != NULL) {
+				parse_keys_values(payload + n, pr->csq);
+				finish_pending_rule(pr);
+			}
+		}
+		free(payload);
+	}
+
+	rules_daemon.len = end - pos;
+	memmove(rules_daemon.buf, pos, rules_daemon.len);
+}
+
+uint64_t pending_rules_deadline(void)
+{
+	uint64_t deadline = 0;
+	for (pending_rule_t *pr = pending_rule_head; pr != NULL; pr = pr->next) {
+		if (pr->deadline > 0 && (deadline == 0 || pr->deadline < deadline)) {
+			deadline = pr->deadline;
+		}
+	}
+	return deadline;
+}
+
+/* Windows whose rules are late are managed with what was received so far,
+ * a trailing token might be incomplete and is dropped. */
+void expire_pending_rules(void)
+{
+	uint64_t now = get_time_ns();
+	pending_rule_t *pr = pending_rule_head;
+	while (pr != NULL) {
+		pending_rule_t *next = pr->next;
+		if (pr->deadline > 0 && now >= pr->deadline) {
+			warn("The external rules command timed out for 0x%08X.\n", pr->win);
+			external_rules_timeouts++;
+			if (pr->fd != -1) {
+				if (!read_pending_rule(pr)) {
+					while (pr->len > 0 && strchr(CSQ_BLK, pr->buf[pr->len - 1]) == NULL) {
+						pr->len--;
+					}
+				}
+				if (pr->pid != -1 && waitpid(pr->pid, NULL, WNOHANG) == 0) {
+					kill(pr->pid, SIGTERM);
+				}
+			}
+			finish_pending_rule(pr);
+		}
+		pr = next;
+	}
+}
+
+pending_rule_t *find_pending_rule(uint32_t request_id)
+{
+	for (pending_rule_t *pr = pending_rule_head; pr != NULL; pr = pr->next) {
+		if (pr->fd == -1 && pr->request_id == request_id) {
+			return pr;
+		}
+	}
+	return NULL;
 }
 
 void parse_key_value(char *key, char *value, rule_consequence_t *csq)
+{
+	rule_delta_t delta = {0};
+	parse_delta_key_value(key, value, &delta);
+	apply_rule_delta(&delta, csq);
+	free_rule_delta(&delta);
+}
+
+void parse_rule_delta(char *buf, rule_delta_t *delta)
+{
+	char *effect = copy_string(buf, strlen(buf));
+	if (effect == NULL) {
+		return;
+	}
+	char *key = strtok(effect, CSQ_BLK);
+	char *value = strtok(NULL, CSQ_BLK);
+	while (key != NULL && value != NULL) {
+		parse_delta_key_value(key, value, delta);
+		key = strtok(NULL, CSQ_BLK);
+		value = strtok(NULL, CSQ_BLK);
+	}
+	free(effect);
+}
+
+void parse_delta_key_value(char *key, char *value, rule_delta_t *delta)
 {
 	bool v;
 	if (streq("monitor", key)) {
-		snprintf(csq->monitor_desc, sizeof(csq->monitor_desc), "%s", value);
+		free(delta->monitor_desc);
+		delta->monitor_desc = copy_string(value, strlen(value));
+		delta->fields |= CSQ_MONITOR;
 	} else if (streq("desktop", key)) {
-		snprintf(csq->desktop_desc, sizeof(csq->desktop_desc), "%s", value);
+		free(delta->desktop_desc);
+		delta->desktop_desc = copy_string(value, strlen(value));
+		delta->fields |= CSQ_DESKTOP;
 	} else if (streq("node", key)) {
-		snprintf(csq->node_desc, sizeof(csq->node_desc), "%s", value);
+		free(delta->node_desc);
+		delta->node_desc = copy_string(value, strlen(value));
+		delta->fields |= CSQ_NODE;
 	} else if (streq("split_dir", key)) {
-		direction_t dir;
-		if (parse_direction(value, &dir)) {
-			SET_CSQ_SPLIT_DIR(dir);
+		if (parse_direction(value, &delta->split_dir)) {
+			delta->fields |= CSQ_SPLIT_DIR;
 		}
 	} else if (streq("state", key)) {
-		client_state_t cst;
-		if (parse_client_state(value, &cst)) {
-			SET_CSQ_STATE(cst);
+		if (parse_client_state(value, &delta->state)) {
+			delta->fields |= CSQ_STATE;
 		}
 	} else if (streq("layer", key)) {
-		stack_layer_t lyr;
-		if (parse_stack_layer(value, &lyr)) {
-			SET_CSQ_LAYER(lyr);
+		if (parse_stack_layer(value, &delta->layer)) {
+			delta->fields |= CSQ_LAYER;
 		}
 	} else if (streq("split_ratio", key)) {
 		double rat;
 		if (sscanf(value, "%lf", &rat) == 1 && rat > 0 && rat < 1) {
-			csq->split_ratio = rat;
+			delta->split_ratio = rat;
+			delta->fields |= CSQ_SPLIT_RATIO;
 		}
 	} else if (streq("rectangle", key)) {
-		if (csq->rect == NULL) {
-			csq->rect = calloc(1, sizeof(xcb_rectangle_t));
-		}
-		if (!parse_rectangle(value, csq->rect)) {
-			free(csq->rect);
-			csq->rect = NULL;
+		if (parse_rectangle(value, &delta->rect)) {
+			delta->fields |= CSQ_RECTANGLE;
 		}
 	} else if (parse_bool(value, &v)) {
+		consequence_field_t f = 0;
 		if (streq("hidden", key)) {
-			csq->hidden = v;
+			f = CSQ_HIDDEN;
 		}
-#define SETCSQ(name) \
+#define SETCSQ(name, field) \
 		else if (streq(#name, key)) { \
-			csq->name = v; \
-		}
-		SETCSQ(sticky)
-		SETCSQ(private)
-		SETCSQ(locked)
-		SETCSQ(marked)
-		SETCSQ(center)
-		SETCSQ(follow)
-		SETCSQ(manage)
-		SETCSQ(focus)
-		SETCSQ(border)
+			f = field; \
+		}
+		SETCSQ(sticky, CSQ_STICKY)
+		SETCSQ(private, CSQ_PRIVATE)
+		SETCSQ(locked, CSQ_LOCKED)
+		SETCSQ(marked, CSQ_MARKED)
+		SETCSQ(center, CSQ_CENTER)
+		SETCSQ(follow, CSQ_FOLLOW)
+		SETCSQ(manage, CSQ_MANAGE)
+		SETCSQ(focus, CSQ_FOCUS)
+		SETCSQ(border, CSQ_BORDER)
 #undef SETCSQ
+		delta->fields |= f;
+		if (v) {
+			delta->values |= f;
+		} else {
+			delta->values &= ~f;
+		}
 	}
 }
 
+void apply_rule_delta(rule_delta_t *delta, rule_consequence_t *csq)
+{
+	unsigned int fields = delta->fields;
+	if (fields & CSQ_MONITOR) {
+		snprintf(csq->monitor_desc, sizeof(csq->monitor_desc), "%s", delta->monitor_desc);
+	}
+	if (fields & CSQ_DESKTOP) {
+		snprintf(csq->desktop_desc, sizeof(csq->desktop_desc), "%s", delta->desktop_desc);
+	}
+	if (fields & CSQ_NODE) {
+		snprintf(csq->node_desc, sizeof(csq->node_desc), "%s", delta->node_desc);
+	}
+	if (fields & CSQ_SPLIT_DIR) {
+		SET_CSQ_SPLIT_DIR(delta->split_dir);
+	}
+	if (fields & CSQ_STATE) {
+		SET_CSQ_STATE(delta->state);
+	}
+	if (fields & CSQ_LAYER) {
+		SET_CSQ_LAYER(delta->layer);
+	}
+	if (fields & CSQ_SPLIT_RATIO) {
+		csq->split_ratio = delta->split_ratio;
+	}
+	if (fields & CSQ_RECTANGLE) {
+		if (csq->rect == NULL) {
+			csq->rect = calloc(1, sizeof(xcb_rectangle_t));
+		}
+		*(csq->rect) = delta->rect;
+	}
+#define APPLYCSQ(name, field) \
+	if (fields & field) { \
+		csq->name = (delta->values & field); \
+	}
+	APPLYCSQ(hidden, CSQ_HIDDEN)
+	APPLYCSQ(sticky, CSQ_STICKY)
+	APPLYCSQ(private, CSQ_PRIVATE)
+	APPLYCSQ(locked, CSQ_LOCKED)
+	APPLYCSQ(marked, CSQ_MARKED)
+	APPLYCSQ(center, CSQ_CENTER)
+	APPLYCSQ(follow, CSQ_FOLLOW)
+	APPLYCSQ(manage, CSQ_MANAGE)
+	APPLYCSQ(focus, CSQ_FOCUS)
+	APPLYCSQ(border, CSQ_BORDER)
+#undef APPLYCSQ
+}
+
+void free_rule_delta(rule_delta_t *delta)
+{
+	free(delta->monitor_desc);
+	free(delta->desktop_desc);
+	free(delta->node_desc);
+	delta->monitor_desc = delta->desktop_desc = delta->node_desc = NULL;
+	delta->fields = delta->values = 0;
+}
+
 #undef SET_CSQ_LAYER
 #undef SET_CSQ_STATE
 
-void list_rules(FILE *rsp)
+/* Strings enclosed in slashes are extended regular expressions, strings
+ * starting with a tilde are shell patterns. */
+bool compile_pattern(const char *s, rule_pattern_t *p)
+{
+	size_t len = strlen(s);
+	if (streq(s, MATCH_ANY)) {
+		p->kind = PATTERN_ANY;
+	} else if (len > 1 && s[0] == '/' && s[len - 1] == '/') {
+		char *re = copy_string((char *) s + 1, len - 2);
+		int ret = regcomp(&p->regex, re, REG_EXTENDED | REG_NOSUB);
+		free(re);
+		if (ret != 0) {
+			return false;
+		}
+		p->kind = PATTERN_REGEX;
+	} else if (len > 1 && s[0] == GLOB_MARKER) {
+		p->kind = PATTERN_GLOB;
+	} else {
+		p->kind = PATTERN_EXACT;
+	}
+	return true;
+}
+
+void free_pattern(rule_pattern_t *p)
+{
+	if (p->kind == PATTERN_REGEX) {
+		regfree(&p->regex);
+	}
+	p->kind = PATTERN_ANY;
+}
+
+bool pattern_matches(rule_pattern_t *p, const char *pattern, const char *s)
+{
+	switch (p->kind) {
+		case PATTERN_ANY:
+			return true;
+		case PATTERN_EXACT:
+			return streq(pattern, s);
+		case PATTERN_GLOB:
+			return fnmatch(pattern + 1, s, 0) == 0;
+		case PATTERN_REGEX:
+			return regexec(&p->regex, s, 0, NULL, 0) == 0;
+	}
+	return false;
+}
+
+const char *index_key(rule_pattern_t *p, const char *s)
+{
+	return (p->kind == PATTERN_EXACT ? s : MATCH_ANY);
+}
+
+uint32_t rule_hash(const char *class_name, const char *instance_name)
+{
+	uint32_t h = 2166136261;
+	for (const char *c = class_name; *c != '\0'; c++) {
+		h = (h ^ (unsigned char) *c) * 16777619;
+	}
+	h = (h ^ ':') * 16777619;
+	for (const char *c = instance_name; *c != '\0'; c++) {
+		h = (h ^ (unsigned char) *c) * 16777619;
+	}
+	return h;
+}
+
+rule_bucket_t *find_rule_bucket(const char *class_name, const char *instance_name)
+{
+	if (rule_index.size == 0) {
+		return NULL;
+	}
+	rule_bucket_t *b = rule_index.buckets[rule_hash(class_name, instance_name) & (rule_index.size - 1)];
+	while (b != NULL && !(streq(b->class_name, class_name) && streq(b->instance_name, instance_name))) {
+		b = b->next;
+	}
+	return b;
+}
+
+bool index_rule(rule_t *r)
+{
+	const char *class_name = index_key(&r->class_pattern, r->class_name);
+	const char *instance_name = index_key(&r->instance_pattern, r->instance_name);
+	rule_bucket_t *b = find_rule_bucket(class_name, instance_name);
+
+	if (b == NULL) {
+		if (rule_index.count >= rule_index.size && !grow_rule_index()) {
+			return false;
+		}
+		b = calloc(1, sizeof(rule_bucket_t));
+		if (b == NULL) {
+			warn("Index rule: can't allocate a bucket.\n");
+			return false;
+		}
+		b->class_name = copy_string((char *) class_name, strlen(class_name));
+		b->instance_name = copy_string((char *) instance_name, strlen(instance_name));
+		if (b->class_name == NULL || b->instance_name == NULL) {
+			free(b->class_name);
+			free(b->instance_name);
+			free(b);
+			return false;
+		}
+		uint32_t i = rule_hash(class_name, instance_name) & (rule_index.size - 1);
+		b->next = rule_index.buckets[i];
+		rule_index.buckets[i] = b;
+		rule_index.count++;
+	}
+
+	if (b->len == b->size) {
+		size_t size = (b->size == 0 ? INIT_CAP : 2 * b->size);
+		rule_t **rules = realloc(b->rules, size * sizeof(rule_t *));
+		if (rules == NULL) {
+			warn("Index rule: can't grow the bucket.\n");
+			return false;
+		}
+		b->rules = rules;
+		b->size = size;
+	}
+
+	r->seq = rule_index.seq++;
+	b->rules[b->len++] = r;
+	return true;
+}
+
+void unindex_rule(rule_t *r)
+{
+	if (rule_index.size == 0) {
+		return;
+	}
+
+	const char *class_name = index_key(&r->class_pattern, r->class_name);
+	const char *instance_name = index_key(&r->instance_pattern, r->instance_name);
+	uint32_t i = rule_hash(class_name, instance_name) & (rule_index.size - 1);
+	rule_bucket_t *prev = NULL, *b = rule_index.buckets[i];
+
+	while (b != NULL && !(streq(b->class_name, class_name) && streq(b->instance_name, instance_name))) {
+		prev = b;
+		b = b->next;
+	}
+
+	if (b == NULL) {
+		return;
+	}
+
+	for (size_t j = 0; j < b->len; j++) {
+		if (b->rules[j] == r) {
+			memmove(b->rules + j, b->rules + j + 1, (b->len - j - 1) * sizeof(rule_t *));
+			b->len--;
+			break;
+		}
+	}
+
+	if (b->len == 0) {
+		if (prev != NULL) {
+			prev->next = b->next;
+		} else {
+			rule_index.buckets[i] = b->next;
+		}
+		free(b->class_name);
+		free(b->instance_name);
+		free(b->rules);
+		free(b);
+		rule_index.count--;
+	}
+}
+
+bool grow_rule_index(void)
+{
+	size_t size = (rule_index.size == 0 ? RULE_INDEX_INIT_SIZE : 2 * rule_index.size);
+	rule_bucket_t **buckets = calloc(size, sizeof(rule_bucket_t *));
+
+	if (buckets == NULL) {
+		warn("Index rule: can't grow the index.\n");
+		return false;
+	}
+
+	for (size_t i = 0; i < rule_index.size; i++) {
+		rule_bucket_t *b = rule_index.buckets[i];
+		while (b != NULL) {
+			rule_bucket_t *next = b->next;
+			uint32_t j = rule_hash(b->class_name, b->instance_name) & (size - 1);
+			b->next = buckets[j];
+			buckets[j] = b;
+			b = next;
+		}
+	}
+
+	free(rule_index.buckets);
+	rule_index.buckets = buckets;
+	rule_index.size = size;
+	return true;
+}
+
+void list_rules(FILE *rsp, bool hits)
 {
 	for (rule_t *r = rule_head; r != NULL; r = r->next) {
-		fprintf(rsp, "%s:%s:%s %c> %s\n", r->class_name, r->instance_name, r->name, r->one_shot?'-':'=', r->effect);
+		fprintf(rsp, "%s:%s:%s %c> %s", r->class_name, r->instance_name, r->name, r->one_shot?'-':'=', r->effect);
+		if (hits) {
+			fprintf(rsp, "\t%u", r->hits);
+		}
+		fprintf(rsp, "\n");
 	}
 }
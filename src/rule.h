@@ -25,11 +25,35 @@
 #ifndef BSPWM_RULE_H
 #define BSPWM_RULE_H
 
-#define MATCH_ANY  "*"
-#define CSQ_BLK    " =,\n"
+#define MATCH_ANY    "*"
+#define GLOB_MARKER  '~'
+#define CSQ_BLK      " =,\n"
+
+#define RULE_INDEX_INIT_SIZE  64
+
+typedef enum {
+	CSQ_MONITOR = 1 << 0,
+	CSQ_DESKTOP = 1 << 1,
+	CSQ_NODE = 1 << 2,
+	CSQ_SPLIT_DIR = 1 << 3,
+	CSQ_SPLIT_RATIO = 1 << 4,
+	CSQ_STATE = 1 << 5,
+	CSQ_LAYER = 1 << 6,
+	CSQ_RECTANGLE = 1 << 7,
+	CSQ_HIDDEN = 1 << 8,
+	CSQ_STICKY = 1 << 9,
+	CSQ_PRIVATE = 1 << 10,
+	CSQ_LOCKED = 1 << 11,
+	CSQ_MARKED = 1 << 12,
+	CSQ_CENTER = 1 << 13,
+	CSQ_FOLLOW = 1 << 14,
+	CSQ_MANAGE = 1 << 15,
+	CSQ_FOCUS = 1 << 16,
+	CSQ_BORDER = 1 << 17
+} consequence_field_t;
 
 rule_t *make_rule(void);
-void add_rule(rule_t *r);
+bool add_rule(rule_t *r);
 void remove_rule(rule_t *r);
 void remove_rule_by_cause(char *cause);
 bool remove_rule_by_index(int idx);
@@ -39,17 +63,39 @@ void add_pending_rule(pending_rule_t *pr);
 void remove_pending_rule(pending_rule_t *pr);
 void postpone_event(pending_rule_t *pr, xcb_generic_event_t *evt);
 event_queue_t *make_event_queue(xcb_generic_event_t *evt);
-void _apply_window_type(xcb_window_t win, rule_consequence_t *csq);
-void _apply_window_state(xcb_window_t win, rule_consequence_t *csq);
-void _apply_transient(xcb_window_t win, rule_consequence_t *csq);
-void _apply_hints(xcb_window_t win, rule_consequence_t *csq);
-void _apply_class(xcb_window_t win, rule_consequence_t *csq);
-void _apply_name(xcb_window_t win, rule_consequence_t *csq);
+void _apply_window_type(xcb_window_t win, window_props_t *wp, rule_consequence_t *csq);
+void _apply_window_state(window_props_t *wp, rule_consequence_t *csq);
+void _apply_transient(window_props_t *wp, rule_consequence_t *csq);
+void _apply_hints(window_props_t *wp, rule_consequence_t *csq);
+void _apply_class(window_props_t *wp, rule_consequence_t *csq);
+void _apply_name(window_props_t *wp, rule_consequence_t *csq);
 void parse_keys_values(char *buf, rule_consequence_t *csq);
-void apply_rules(xcb_window_t win, rule_consequence_t *csq);
+void apply_rules(xcb_window_t win, window_props_t *wp, rule_consequence_t *csq);
 bool schedule_rules(xcb_window_t win, rule_consequence_t *csq);
-void parse_rule_consequence(int fd, rule_consequence_t *csq);
+bool read_pending_rule(pending_rule_t *pr);
+void finish_pending_rule(pending_rule_t *pr);
+bool start_rules_daemon(void);
+void stop_rules_daemon(void);
+bool send_rule_request(pending_rule_t *pr);
+void drop_rules_daemon(bool respawn);
+void handle_rules_daemon(void);
+uint64_t pending_rules_deadline(void);
+void expire_pending_rules(void);
+pending_rule_t *find_pending_rule(uint32_t request_id);
 void parse_key_value(char *key, char *value, rule_consequence_t *csq);
-void list_rules(FILE *rsp);
+void parse_rule_delta(char *buf, rule_delta_t *delta);
+void parse_delta_key_value(char *key, char *value, rule_delta_t *delta);
+void apply_rule_delta(rule_delta_t *delta, rule_consequence_t *csq);
+void free_rule_delta(rule_delta_t *delta);
+bool compile_pattern(const char *s, rule_pattern_t *p);
+void free_pattern(rule_pattern_t *p);
+bool pattern_matches(rule_pattern_t *p, const char *pattern, const char *s);
+const char *index_key(rule_pattern_t *p, const char *s);
+uint32_t rule_hash(const char *class_name, const char *instance_name);
+rule_bucket_t *find_rule_bucket(const char *class_name, const char *instance_name);
+bool index_rule(rule_t *r);
+void unindex_rule(rule_t *r);
+bool grow_rule_index(void);
+void list_rules(FILE *rsp, bool hits);
 
 #endif
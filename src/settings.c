@@ -29,6 +29,8 @@
 #include "settings.h"
 
 char external_rules_command[MAXLEN];
+bool external_rules_daemon;
+uint32_t external_rules_timeout;
 char status_prefix[MAXLEN];
 
 char normal_border_color[MAXLEN];
@@ -48,6 +50,7 @@ tightness_t directional_focus_tightness;
 
 uint16_t pointer_modifier;
 uint32_t pointer_motion_interval;
+drag_mode_t pointer_drag_mode;
 pointer_action_t pointer_actions[3];
 int8_t mapping_events_count;
 
@@ -73,6 +76,9 @@ bool remove_disabled_monitors;
 bool remove_unplugged_monitors;
 bool merge_overlapping_monitors;
 
+bool state_mirror;
+bool desktop_containers;
+
 void run_config(int run_level)
 {
 	if (fork() == 0) {
@@ -90,6 +96,8 @@ void run_config(int run_level)
 void load_settings(void)
 {
 	snprintf(external_rules_command, sizeof(external_rules_command), "%s", EXTERNAL_RULES_COMMAND);
+	external_rules_daemon = EXTERNAL_RULES_DAEMON;
+	external_rules_timeout = EXTERNAL_RULES_TIMEOUT;
 	snprintf(status_prefix, sizeof(status_prefix), "%s", STATUS_PREFIX);
 
 	snprintf(normal_border_color, sizeof(normal_border_color), "%s", NORMAL_BORDER_COLOR);
@@ -109,6 +117,7 @@ void load_settings(void)
 
 	pointer_modifier = POINTER_MODIFIER;
 	pointer_motion_interval = POINTER_MOTION_INTERVAL;
+	pointer_drag_mode = POINTER_DRAG_MODE;
 	pointer_actions[0] = ACTION_MOVE;
 	pointer_actions[1] = ACTION_RESIZE_SIDE;
 	pointer_actions[2] = ACTION_RESIZE_CORNER;
@@ -135,4 +144,7 @@ void load_settings(void)
 	remove_disabled_monitors = REMOVE_DISABLED_MONITORS;
 	remove_unplugged_monitors = REMOVE_UNPLUGGED_MONITORS;
 	merge_overlapping_monitors = MERGE_OVERLAPPING_MONITORS;
+
+	state_mirror = STATE_MIRROR;
+	desktop_containers = DESKTOP_CONTAINERS;
 }
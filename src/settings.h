@@ -29,7 +29,10 @@
 
 #define POINTER_MODIFIER         XCB_MOD_MASK_4
 #define POINTER_MOTION_INTERVAL  17
+#define POINTER_DRAG_MODE        DRAG_MODE_LIVE
 #define EXTERNAL_RULES_COMMAND   ""
+#define EXTERNAL_RULES_DAEMON    false
+#define EXTERNAL_RULES_TIMEOUT   0
 #define STATUS_PREFIX            "W"
 
 #define NORMAL_BORDER_COLOR           "#30302f"
@@ -68,7 +71,12 @@
 #define REMOVE_UNPLUGGED_MONITORS   false
 #define MERGE_OVERLAPPING_MONITORS  false
 
+#define STATE_MIRROR                false
+#define DESKTOP_CONTAINERS          false
+
 extern char external_rules_command[MAXLEN];
+extern bool external_rules_daemon;
+extern uint32_t external_rules_timeout;
 extern char status_prefix[MAXLEN];
 
 extern char normal_border_color[MAXLEN];
@@ -88,6 +96,7 @@ extern tightness_t directional_focus_tightness;
 
 extern uint16_t pointer_modifier;
 extern uint32_t pointer_motion_interval;
+extern drag_mode_t pointer_drag_mode;
 extern pointer_action_t pointer_actions[3];
 extern int8_t mapping_events_count;
 
@@ -113,6 +122,9 @@ extern bool remove_disabled_monitors;
 extern bool remove_unplugged_monitors;
 extern bool merge_overlapping_monitors;
 
+extern bool state_mirror;
+extern bool desktop_containers;
+
 void run_config(int run_level);
 void load_settings(void);
 
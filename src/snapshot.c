@@ -0,0 +1,929 @@
+/* Copyright (c) 2012, Bastien Dejean
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "bspwm.h"
+#include "desktop.h"
+#include "history.h"
+#include "monitor.h"
+#include "query.h"
+#include "restore.h"
+#include "stack.h"
+#include "subscribe.h"
+#include "tree.h"
+#include "snapshot.h"
+
+bool is_snapshot(const char *data, size_t len)
+{
+	return (len >= SNAPSHOT_HEADER_LEN && strncmp(data, SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_LEN) == 0);
+}
+
+bool check_snapshot(const char *data, size_t len)
+{
+	if (!is_snapshot(data, len)) {
+		warn("Check snapshot: invalid header.\n");
+		return false;
+	}
+
+	snapshot_reader_t r = {(const uint8_t *) data, SNAPSHOT_MAGIC_LEN, len, len};
+	uint16_t version = get_u16(&r);
+	uint16_t compat_version = get_u16(&r);
+
+	if (compat_version > SNAPSHOT_VERSION) {
+		warn("Check snapshot: version %u requires a reader version of at least %u, this is version %u.\n", version, compat_version, SNAPSHOT_VERSION);
+		return false;
+	}
+
+	snapshot_tag_t tag;
+	r.end = r.pos;
+
+	while (next_record(&r, &tag)) {
+		if (tag == SNAPSHOT_END) {
+			return true;
+		}
+	}
+
+	warn("Check snapshot: truncated data.\n");
+	return false;
+}
+
+void write_snapshot(snapshot_writer_t *w)
+{
+	put_bytes(w, SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_LEN);
+	put_u16(w, SNAPSHOT_VERSION);
+	put_u16(w, SNAPSHOT_COMPAT_VERSION);
+
+	begin_record(w, SNAPSHOT_STATE);
+	put_u32(w, mon->id);
+	put_u32(w, pri_mon != NULL ? pri_mon->id : 0);
+	put_u32(w, clients_count);
+	end_record(w);
+
+	for (monitor_t *m = mon_head; m != NULL; m = m->next) {
+		write_monitor(w, m);
+	}
+
+	write_history(w);
+	write_stack(w);
+
+	if (restart) {
+		write_subscribers(w);
+	}
+
+	begin_record(w, SNAPSHOT_END);
+	end_record(w);
+}
+
+bool save_snapshot(const char *file_path)
+{
+	snapshot_writer_t w = {NULL, 0, 0, 0, false};
+
+	write_snapshot(&w);
+
+	if (w.failed) {
+		free(w.data);
+		return false;
+	}
+
+	FILE *f = fopen(file_path, "w");
+
+	if (f == NULL) {
+		perror("Save snapshot: fopen");
+		free(w.data);
+		return false;
+	}
+
+	bool ret = (fwrite(w.data, 1, w.len, f) == w.len);
+
+	if (!ret) {
+		perror("Save snapshot: fwrite");
+	}
+
+	fclose(f);
+	free(w.data);
+
+	return ret;
+}
+
+/* The snapshot is loaded next to the live state, which is only torn down
+ * once the snapshot is known to be complete. */
+bool restore_snapshot(const char *data, size_t len)
+{
+	if (!check_snapshot(data, len)) {
+		return false;
+	}
+
+	snapshot_state_t live, loaded;
+	detach_state(&live);
+
+	if (!load_snapshot(data, len)) {
+		discard_snapshot();
+		attach_state(&live);
+		return false;
+	}
+
+	detach_state(&loaded);
+	attach_state(&live);
+
+	mon = NULL;
+	while (mon_head != NULL) {
+		remove_monitor(mon_head);
+	}
+
+	attach_state(&loaded);
+	load_subscribers(data, len);
+
+	for (monitor_t *m = mon_head; m != NULL; m = m->next) {
+		create_root(m);
+		if (m->desk == NULL) {
+			m->desk = m->desk_head;
+		}
+		if (m->desk == NULL) {
+			add_desktop(m, make_desktop(NULL, XCB_NONE));
+		}
+	}
+
+	restore_windows();
+
+	return true;
+}
+
+/* Saves the global state in the given structure and clears it. */
+void detach_state(snapshot_state_t *s)
+{
+	s->mon = mon;
+	s->mon_head = mon_head;
+	s->mon_tail = mon_tail;
+	s->pri_mon = pri_mon;
+	s->history_head = history_head;
+	s->history_tail = history_tail;
+	s->history_needle = history_needle;
+	s->stack_head = stack_head;
+	s->stack_tail = stack_tail;
+	s->clients_count = clients_count;
+	mon = mon_head = mon_tail = pri_mon = NULL;
+	history_head = history_tail = history_needle = NULL;
+	stack_head = stack_tail = NULL;
+	clients_count = 0;
+}
+
+void attach_state(snapshot_state_t *s)
+{
+	mon = s->mon;
+	mon_head = s->mon_head;
+	mon_tail = s->mon_tail;
+	pri_mon = s->pri_mon;
+	history_head = s->history_head;
+	history_tail = s->history_tail;
+	history_needle = s->history_needle;
+	stack_head = s->stack_head;
+	stack_tail = s->stack_tail;
+	clients_count = s->clients_count;
+}
+
+void load_subscribers(const char *data, size_t len)
+{
+	snapshot_reader_t r = {(const uint8_t *) data, SNAPSHOT_HEADER_LEN, SNAPSHOT_HEADER_LEN, len};
+	snapshot_tag_t tag;
+
+	while (next_record(&r, &tag) && tag != SNAPSHOT_END) {
+		if (tag == SNAPSHOT_SUBSCRIBER) {
+			read_subscriber(&r);
+		}
+	}
+}
+
+/* Free a loaded state that was never shown: no windows exist yet. */
+void discard_snapshot(void)
+{
+	monitor_t *m = mon_head;
+	while (m != NULL) {
+		monitor_t *next_mon = m->next;
+		desktop_t *d = m->desk_head;
+		while (d != NULL) {
+			desktop_t *next_desk = d->next;
+			free_node(d->root);
+			free(d);
+			d = next_desk;
+		}
+		free(m);
+		m = next_mon;
+	}
+	mon = mon_head = mon_tail = pri_mon = NULL;
+	empty_history();
+	history_needle = NULL;
+	while (stack_head != NULL) {
+		remove_stack(stack_head);
+	}
+}
+
+/* Subscribers aren't loaded, see `load_subscribers`. */
+bool load_snapshot(const char *data, size_t len)
+{
+	snapshot_reader_t r = {(const uint8_t *) data, SNAPSHOT_HEADER_LEN, SNAPSHOT_HEADER_LEN, len};
+	snapshot_index_t idx = {NULL, 0, 0, true};
+	uint32_t focused_monitor_id = 0, primary_monitor_id = 0, focused_desktop_id = 0;
+	monitor_t *m = NULL;
+	desktop_t *d = NULL;
+	snapshot_tag_t tag;
+	bool ret = false;
+
+	while (next_record(&r, &tag)) {
+		switch (tag) {
+			case SNAPSHOT_STATE:
+				focused_monitor_id = get_u32(&r);
+				primary_monitor_id = get_u32(&r);
+				clients_count = get_u32(&r);
+				break;
+			case SNAPSHOT_MONITOR:
+				m = read_monitor(&r, &focused_desktop_id);
+				if (mon_head == NULL) {
+					mon_head = mon_tail = m;
+				} else {
+					mon_tail->next = m;
+					m->prev = mon_tail;
+					mon_tail = m;
+				}
+				index_add(&idx, m->id, m, NULL, NULL);
+				break;
+			case SNAPSHOT_DESKTOP:
+				if (m == NULL) {
+					warn("Load snapshot: desktop without monitor.\n");
+					goto end;
+				}
+				if ((d = read_desktop(&r, m, &idx)) == NULL) {
+					goto end;
+				}
+				insert_desktop(m, d);
+				if (d->id == focused_desktop_id) {
+					m->desk = d;
+				}
+				break;
+			case SNAPSHOT_HISTORY:
+				read_history(&r, &idx);
+				break;
+			case SNAPSHOT_STACK:
+				read_stack(&r, &idx);
+				break;
+			case SNAPSHOT_END:
+				ret = true;
+				goto end;
+			default:
+				break;
+		}
+	}
+
+end:
+	for (monitor_t *a = mon_head; a != NULL; a = a->next) {
+		if (a->id == focused_monitor_id) {
+			mon = a;
+		}
+		if (a->id == primary_monitor_id) {
+			pri_mon = a;
+		}
+	}
+
+	if (mon == NULL) {
+		mon = mon_head;
+	}
+
+	if (mon == NULL) {
+		warn("Load snapshot: no monitors.\n");
+		ret = false;
+	}
+
+	free(idx.entries);
+
+	return ret;
+}
+
+bool print_snapshot(const char *file_path, FILE *rsp)
+{
+	size_t len;
+	char *data = map_file(file_path, &len);
+
+	if (data == NULL) {
+		return false;
+	}
+
+	bool ret = check_snapshot(data, len) && load_snapshot(data, len);
+
+	for (monitor_t *m = mon_head; ret && m != NULL; m = m->next) {
+		if (m->desk == NULL) {
+			warn("Print snapshot: monitor without desktops: '%s'.\n", m->name);
+			ret = false;
+		}
+	}
+
+	if (ret) {
+		query_state(rsp);
+		fprintf(rsp, "\n");
+	}
+
+	munmap(data, len);
+
+	return ret;
+}
+
+void write_monitor(snapshot_writer_t *w, monitor_t *m)
+{
+	begin_record(w, SNAPSHOT_MONITOR);
+	put_string(w, m->name);
+	put_u32(w, m->id);
+	put_u32(w, m->randr_id);
+	put_u8(w, m->wired);
+	put_u32(w, m->sticky_count);
+	put_i32(w, m->window_gap);
+	put_u32(w, m->border_width);
+	put_u32(w, m->desk->id);
+	put_padding(w, m->padding);
+	put_rect(w, m->rectangle);
+	end_record(w);
+
+	for (desktop_t *d = m->desk_head; d != NULL; d = d->next) {
+		write_desktop(w, d);
+	}
+}
+
+void write_desktop(snapshot_writer_t *w, desktop_t *d)
+{
+	begin_record(w, SNAPSHOT_DESKTOP);
+	put_string(w, d->name);
+	put_u32(w, d->id);
+	put_u8(w, d->layout);
+	put_u8(w, d->user_layout);
+	put_i32(w, d->window_gap);
+	put_u32(w, d->border_width);
+	put_u32(w, d->focus != NULL ? d->focus->id : 0);
+	put_padding(w, d->padding);
+	put_u8(w, d->root != NULL);
+	put_u8(w, d->stale);
+	end_record(w);
+
+	if (d->root != NULL) {
+		write_node(w, d->root);
+	}
+}
+
+void write_node(snapshot_writer_t *w, node_t *n)
+{
+	uint16_t flags = (n->vacant ? SNAPSHOT_NODE_VACANT : 0) |
+	                 (n->hidden ? SNAPSHOT_NODE_HIDDEN : 0) |
+	                 (n->sticky ? SNAPSHOT_NODE_STICKY : 0) |
+	                 (n->private ? SNAPSHOT_NODE_PRIVATE : 0) |
+	                 (n->locked ? SNAPSHOT_NODE_LOCKED : 0) |
+	                 (n->marked ? SNAPSHOT_NODE_MARKED : 0) |
+	                 (n->presel != NULL ? SNAPSHOT_NODE_PRESEL : 0) |
+	                 (n->client != NULL ? SNAPSHOT_NODE_CLIENT : 0) |
+	                 (n->first_child != NULL ? SNAPSHOT_NODE_FIRST_CHILD : 0) |
+	                 (n->second_child != NULL ? SNAPSHOT_NODE_SECOND_CHILD : 0);
+
+	begin_record(w, SNAPSHOT_NODE);
+	put_u32(w, n->id);
+	put_u16(w, flags);
+	put_u8(w, n->split_type);
+	put_double(w, n->split_ratio);
+	put_rect(w, n->rectangle);
+	put_u16(w, n->constraints.min_width);
+	put_u16(w, n->constraints.min_height);
+	if (n->presel != NULL) {
+		put_u8(w, n->presel->split_dir);
+		put_double(w, n->presel->split_ratio);
+	} else {
+		put_u8(w, 0);
+		put_double(w, 0);
+	}
+	end_record(w);
+
+	if (n->client != NULL) {
+		write_client(w, n->client);
+	}
+	if (n->first_child != NULL) {
+		write_node(w, n->first_child);
+	}
+	if (n->second_child != NULL) {
+		write_node(w, n->second_child);
+	}
+}
+
+void write_client(snapshot_writer_t *w, client_t *c)
+{
+	begin_record(w, SNAPSHOT_CLIENT);
+	put_string(w, c->class_name);
+	put_string(w, c->instance_name);
+	put_u32(w, c->border_width);
+	put_u8(w, c->state);
+	put_u8(w, c->last_state);
+	put_u8(w, c->layer);
+	put_u8(w, c->last_layer);
+	put_u8(w, c->urgent);
+	put_u8(w, c->shown);
+	put_rect(w, c->tiled_rectangle);
+	put_rect(w, c->floating_rectangle);
+	end_record(w);
+}
+
+void write_history(snapshot_writer_t *w)
+{
+	uint32_t count = 0;
+	for (history_t *h = history_head; h != NULL; h = h->next) {
+		count++;
+	}
+
+	begin_record(w, SNAPSHOT_HISTORY);
+	put_u32(w, count);
+	for (history_t *h = history_head; h != NULL; h = h->next) {
+		put_u32(w, h->loc.monitor->id);
+		put_u32(w, h->loc.desktop->id);
+		put_u32(w, h->loc.node != NULL ? h->loc.node->id : 0);
+	}
+	end_record(w);
+}
+
+void write_stack(snapshot_writer_t *w)
+{
+	uint32_t count = 0;
+	for (stacking_list_t *s = stack_head; s != NULL; s = s->next) {
+		count++;
+	}
+
+	begin_record(w, SNAPSHOT_STACK);
+	put_u32(w, count);
+	for (stacking_list_t *s = stack_head; s != NULL; s = s->next) {
+		put_u32(w, s->node->id);
+	}
+	end_record(w);
+}
+
+void write_subscribers(snapshot_writer_t *w)
+{
+	for (subscriber_list_t *s = subscribe_head; s != NULL; s = s->next) {
+		begin_record(w, SNAPSHOT_SUBSCRIBER);
+		put_i32(w, fileno(s->stream));
+		put_string(w, s->fifo_path != NULL ? s->fifo_path : "");
+		put_i32(w, s->field);
+		put_i32(w, s->count);
+		put_u32(w, s->monitor_id);
+		put_u32(w, s->desktop_id);
+		put_u32(w, s->node_id);
+		put_u32(w, s->max_rate);
+		put_i32(w, s->coalesce);
+		put_u32(w, s->coalesced);
+		put_u32(w, s->dropped);
+		end_record(w);
+	}
+}
+
+void begin_record(snapshot_writer_t *w, snapshot_tag_t tag)
+{
+	put_u8(w, tag);
+	w->record = w->len;
+	put_u32(w, 0);
+}
+
+void end_record(snapshot_writer_t *w)
+{
+	if (w->failed) {
+		return;
+	}
+	uint32_t len = w->len - w->record - sizeof(uint32_t);
+	for (size_t i = 0; i < sizeof(uint32_t); i++) {
+		w->data[w->record + i] = (len >> (8 * i)) & 0xFF;
+	}
+}
+
+void put_bytes(snapshot_writer_t *w, const void *data, size_t len)
+{
+	if (w->failed) {
+		return;
+	}
+	if (w->len + len > w->size) {
+		size_t size = MAX(2 * w->size, MAX(BUFSIZ, w->len + len));
+		uint8_t *rdata = realloc(w->data, size);
+		if (rdata == NULL) {
+			perror("Save snapshot: realloc");
+			w->failed = true;
+			return;
+		}
+		w->data = rdata;
+		w->size = size;
+	}
+	memcpy(w->data + w->len, data, len);
+	w->len += len;
+}
+
+void put_u8(snapshot_writer_t *w, uint8_t v)
+{
+	put_bytes(w, &v, sizeof(v));
+}
+
+void put_u16(snapshot_writer_t *w, uint16_t v)
+{
+	uint8_t b[] = {v & 0xFF, v >> 8};
+	put_bytes(w, b, sizeof(b));
+}
+
+void put_u32(snapshot_writer_t *w, uint32_t v)
+{
+	uint8_t b[] = {v & 0xFF, (v >> 8) & 0xFF, (v >> 16) & 0xFF, v >> 24};
+	put_bytes(w, b, sizeof(b));
+}
+
+void put_i32(snapshot_writer_t *w, int32_t v)
+{
+	put_u32(w, (uint32_t) v);
+}
+
+void put_double(snapshot_writer_t *w, double v)
+{
+	uint64_t u;
+	memcpy(&u, &v, sizeof(u));
+	put_u32(w, u & 0xFFFFFFFF);
+	put_u32(w, u >> 32);
+}
+
+void put_string(snapshot_writer_t *w, const char *s)
+{
+	size_t len = strlen(s);
+	put_u16(w, len);
+	put_bytes(w, s, len);
+}
+
+void put_rect(snapshot_writer_t *w, xcb_rectangle_t r)
+{
+	put_u16(w, (uint16_t) r.x);
+	put_u16(w, (uint16_t) r.y);
+	put_u16(w, r.width);
+	put_u16(w, r.height);
+}
+
+void put_padding(snapshot_writer_t *w, padding_t p)
+{
+	put_i32(w, p.top);
+	put_i32(w, p.right);
+	put_i32(w, p.bottom);
+	put_i32(w, p.left);
+}
+
+monitor_t *read_monitor(snapshot_reader_t *r, uint32_t *focused_desktop_id)
+{
+	char name[SMALEN];
+	get_string(r, name, sizeof(name));
+	monitor_t *m = make_monitor(name, NULL, UINT32_MAX);
+	m->id = get_u32(r);
+	m->randr_id = get_u32(r);
+	m->wired = get_u8(r);
+	m->sticky_count = get_u32(r);
+	m->window_gap = get_i32(r);
+	m->border_width = get_u32(r);
+	*focused_desktop_id = get_u32(r);
+	m->padding = get_padding(r);
+	m->rectangle = get_rect(r);
+	return m;
+}
+
+desktop_t *read_desktop(snapshot_reader_t *r, monitor_t *m, snapshot_index_t *idx)
+{
+	char name[SMALEN];
+	get_string(r, name, sizeof(name));
+	desktop_t *d = make_desktop(name, UINT32_MAX);
+	d->id = get_u32(r);
+	d->layout = get_u8(r);
+	d->user_layout = get_u8(r);
+	d->window_gap = get_i32(r);
+	d->border_width = get_u32(r);
+	uint32_t focused_node_id = get_u32(r);
+	d->padding = get_padding(r);
+	bool has_root = get_u8(r);
+	d->stale = get_u8(r);
+
+	index_add(idx, d->id, m, d, NULL);
+
+	if (has_root) {
+		if (!expect_record(r, SNAPSHOT_NODE)) {
+			warn("Load snapshot: missing root of desktop '%s'.\n", d->name);
+			free(d);
+			return NULL;
+		}
+		d->root = read_node(r, m, d, idx);
+		if (d->root == NULL) {
+			free(d);
+			return NULL;
+		}
+	}
+
+	if (focused_node_id != 0) {
+		d->focus = find_by_id_in(d->root, focused_node_id);
+	}
+
+	return d;
+}
+
+node_t *read_node(snapshot_reader_t *r, monitor_t *m, desktop_t *d, snapshot_index_t *idx)
+{
+	node_t *n = make_node(UINT32_MAX);
+	n->id = get_u32(r);
+	uint16_t flags = get_u16(r);
+	n->split_type = get_u8(r);
+	n->split_ratio = get_double(r);
+	n->rectangle = get_rect(r);
+	n->constraints.min_width = get_u16(r);
+	n->constraints.min_height = get_u16(r);
+	n->vacant = flags & SNAPSHOT_NODE_VACANT;
+	n->hidden = flags & SNAPSHOT_NODE_HIDDEN;
+	n->sticky = flags & SNAPSHOT_NODE_STICKY;
+	n->private = flags & SNAPSHOT_NODE_PRIVATE;
+	n->locked = flags & SNAPSHOT_NODE_LOCKED;
+	n->marked = flags & SNAPSHOT_NODE_MARKED;
+
+	direction_t split_dir = get_u8(r);
+	double split_ratio = get_double(r);
+
+	if (flags & SNAPSHOT_NODE_PRESEL) {
+		n->presel = make_presel();
+		n->presel->split_dir = split_dir;
+		n->presel->split_ratio = split_ratio;
+	}
+
+	index_add(idx, n->id, m, d, n);
+
+	if (flags & SNAPSHOT_NODE_CLIENT) {
+		if (!expect_record(r, SNAPSHOT_CLIENT)) {
+			goto fail;
+		}
+		n->client = read_client(r);
+	}
+
+	if (flags & SNAPSHOT_NODE_FIRST_CHILD) {
+		if (!expect_record(r, SNAPSHOT_NODE) || (n->first_child = read_node(r, m, d, idx)) == NULL) {
+			goto fail;
+		}
+		n->first_child->parent = n;
+	}
+
+	if (flags & SNAPSHOT_NODE_SECOND_CHILD) {
+		if (!expect_record(r, SNAPSHOT_NODE) || (n->second_child = read_node(r, m, d, idx)) == NULL) {
+			goto fail;
+		}
+		n->second_child->parent = n;
+	}
+
+	return n;
+
+fail:
+	warn("Load snapshot: incomplete node 0x%08X.\n", n->id);
+	free_node(n);
+	return NULL;
+}
+
+client_t *read_client(snapshot_reader_t *r)
+{
+	client_t *c = make_client();
+	get_string(r, c->class_name, sizeof(c->class_name));
+	get_string(r, c->instance_name, sizeof(c->instance_name));
+	c->border_width = get_u32(r);
+	c->state = get_u8(r);
+	c->last_state = get_u8(r);
+	c->layer = get_u8(r);
+	c->last_layer = get_u8(r);
+	c->urgent = get_u8(r);
+	c->shown = get_u8(r);
+	c->tiled_rectangle = get_rect(r);
+	c->floating_rectangle = get_rect(r);
+	return c;
+}
+
+void read_history(snapshot_reader_t *r, snapshot_index_t *idx)
+{
+	uint32_t count = get_u32(r);
+
+	for (uint32_t i = 0; i < count; i++) {
+		uint32_t monitor_id = get_u32(r);
+		uint32_t desktop_id = get_u32(r);
+		uint32_t node_id = get_u32(r);
+		snapshot_entry_t *de = index_find(idx, desktop_id);
+		if (de == NULL || de->desktop == NULL || de->monitor->id != monitor_id) {
+			continue;
+		}
+		snapshot_entry_t *ne = (node_id != 0 ? index_find(idx, node_id) : NULL);
+		node_t *n = (ne != NULL && ne->desktop == de->desktop) ? ne->node : NULL;
+		history_add(de->monitor, de->desktop, n, true);
+	}
+}
+
+void read_stack(snapshot_reader_t *r, snapshot_index_t *idx)
+{
+	uint32_t count = get_u32(r);
+
+	for (uint32_t i = 0; i < count; i++) {
+		snapshot_entry_t *e = index_find(idx, get_u32(r));
+		if (e != NULL && e->node != NULL && e->node->client != NULL) {
+			stack_insert_after(stack_tail, e->node);
+		}
+	}
+}
+
+void read_subscriber(snapshot_reader_t *r)
+{
+	int fd = get_i32(r);
+	char fifo_path[MAXLEN];
+	get_string(r, fifo_path, sizeof(fifo_path));
+	int field = get_i32(r);
+	int count = get_i32(r);
+	uint32_t monitor_id = get_u32(r);
+	uint32_t desktop_id = get_u32(r);
+	uint32_t node_id = get_u32(r);
+	unsigned int max_rate = get_u32(r);
+	int coalesce = get_i32(r);
+	unsigned int coalesced = get_u32(r);
+	unsigned int dropped = get_u32(r);
+	FILE *stream = fdopen(fd, "w");
+
+	if (stream == NULL) {
+		warn("Load snapshot: can't open the subscriber's stream: %i.\n", fd);
+		return;
+	}
+
+	char *path = (fifo_path[0] != '\0' ? copy_string(fifo_path, strlen(fifo_path)) : NULL);
+	subscriber_list_t *sb = make_subscriber(stream, path, field, count);
+	sb->monitor_id = monitor_id;
+	sb->desktop_id = desktop_id;
+	sb->node_id = node_id;
+	sb->max_rate = max_rate;
+	sb->coalesce = coalesce;
+	sb->coalesced = coalesced;
+	sb->dropped = dropped;
+	add_subscriber(sb);
+}
+
+bool next_record(snapshot_reader_t *r, snapshot_tag_t *tag)
+{
+	r->pos = r->end;
+
+	if (r->len - r->pos < SNAPSHOT_RECORD_HEAD_LEN) {
+		return false;
+	}
+
+	r->end = r->len;
+	*tag = get_u8(r);
+	uint32_t len = get_u32(r);
+
+	if (r->len - r->pos < len) {
+		r->end = r->pos = r->len;
+		return false;
+	}
+
+	r->end = r->pos + len;
+
+	return true;
+}
+
+bool expect_record(snapshot_reader_t *r, snapshot_tag_t tag)
+{
+	snapshot_tag_t t;
+
+	while (next_record(r, &t)) {
+		if (t == tag) {
+			return true;
+		} else if (t <= SNAPSHOT_SUBSCRIBER) {
+			return false;
+		}
+	}
+
+	return false;
+}
+
+void get_bytes(snapshot_reader_t *r, void *data, size_t len)
+{
+	if (r->end - r->pos < len) {
+		memset(data, 0, len);
+		r->pos = r->end;
+	} else {
+		memcpy(data, r->data + r->pos, len);
+		r->pos += len;
+	}
+}
+
+uint8_t get_u8(snapshot_reader_t *r)
+{
+	uint8_t v;
+	get_bytes(r, &v, sizeof(v));
+	return v;
+}
+
+uint16_t get_u16(snapshot_reader_t *r)
+{
+	uint8_t b[2];
+	get_bytes(r, b, sizeof(b));
+	return b[0] | (b[1] << 8);
+}
+
+uint32_t get_u32(snapshot_reader_t *r)
+{
+	uint8_t b[4];
+	get_bytes(r, b, sizeof(b));
+	return b[0] | (b[1] << 8) | (b[2] << 16) | ((uint32_t) b[3] << 24);
+}
+
+int32_t get_i32(snapshot_reader_t *r)
+{
+	return (int32_t) get_u32(r);
+}
+
+double get_double(snapshot_reader_t *r)
+{
+	uint64_t u = get_u32(r);
+	u |= (uint64_t) get_u32(r) << 32;
+	double v;
+	memcpy(&v, &u, sizeof(v));
+	return v;
+}
+
+void get_string(snapshot_reader_t *r, char *buf, size_t size)
+{
+	size_t len = get_u16(r);
+	size_t avail = MIN(len, r->end - r->pos);
+	snprintf(buf, size, "%.*s", (int) avail, (const char *) r->data + r->pos);
+	r->pos += avail;
+}
+
+xcb_rectangle_t get_rect(snapshot_reader_t *r)
+{
+	xcb_rectangle_t rect;
+	rect.x = (int16_t) get_u16(r);
+	rect.y = (int16_t) get_u16(r);
+	rect.width = get_u16(r);
+	rect.height = get_u16(r);
+	return rect;
+}
+
+padding_t get_padding(snapshot_reader_t *r)
+{
+	padding_t p;
+	p.top = get_i32(r);
+	p.right = get_i32(r);
+	p.bottom = get_i32(r);
+	p.left = get_i32(r);
+	return p;
+}
+
+void index_add(snapshot_index_t *idx, uint32_t id, monitor_t *m, desktop_t *d, node_t *n)
+{
+	if (idx->len == idx->size) {
+		size_t size = MAX(2 * idx->size, INIT_CAP);
+		snapshot_entry_t *entries = realloc(idx->entries, size * sizeof(snapshot_entry_t));
+		if (entries == NULL) {
+			perror("Load snapshot: realloc");
+			return;
+		}
+		idx->entries = entries;
+		idx->size = size;
+	}
+	idx->entries[idx->len++] = (snapshot_entry_t) {id, m, d, n};
+	idx->sorted = false;
+}
+
+snapshot_entry_t *index_find(snapshot_index_t *idx, uint32_t id)
+{
+	if (idx->len == 0) {
+		return NULL;
+	}
+	if (!idx->sorted) {
+		qsort(idx->entries, idx->len, sizeof(snapshot_entry_t), entry_cmp);
+		idx->sorted = true;
+	}
+	snapshot_entry_t key = {id, NULL, NULL, NULL};
+	return bsearch(&key, idx->entries, idx->len, sizeof(snapshot_entry_t), entry_cmp);
+}
+
+int entry_cmp(const void *a, const void *b)
+{
+	uint32_t i = ((const snapshot_entry_t *) a)->id;
+	uint32_t j = ((const snapshot_entry_t *) b)->id;
+	return (i > j) - (i < j);
+}
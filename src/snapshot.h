@@ -0,0 +1,162 @@
+/* Copyright (c) 2012, Bastien Dejean
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef BSPWM_SNAPSHOT_H
+#define BSPWM_SNAPSHOT_H
+
+/* A snapshot starts with a header: the magic string, the version of the
+ * writer and the oldest reader version able to read it (all integers are
+ * little-endian). It is followed by records made of a one byte tag, a four
+ * bytes payload length and the payload itself. Readers skip unknown records
+ * and the trailing fields they don't know, missing fields are zeroed. */
+
+#define SNAPSHOT_MAGIC            "BSPS"
+#define SNAPSHOT_MAGIC_LEN        4
+#define SNAPSHOT_VERSION          1
+#define SNAPSHOT_COMPAT_VERSION   1
+#define SNAPSHOT_HEADER_LEN       (SNAPSHOT_MAGIC_LEN + 2 * sizeof(uint16_t))
+#define SNAPSHOT_RECORD_HEAD_LEN  (sizeof(uint8_t) + sizeof(uint32_t))
+
+typedef enum {
+	SNAPSHOT_END,
+	SNAPSHOT_STATE,
+	SNAPSHOT_MONITOR,
+	SNAPSHOT_DESKTOP,
+	SNAPSHOT_NODE,
+	SNAPSHOT_CLIENT,
+	SNAPSHOT_HISTORY,
+	SNAPSHOT_STACK,
+	SNAPSHOT_SUBSCRIBER
+} snapshot_tag_t;
+
+typedef enum {
+	SNAPSHOT_NODE_VACANT = 1 << 0,
+	SNAPSHOT_NODE_HIDDEN = 1 << 1,
+	SNAPSHOT_NODE_STICKY = 1 << 2,
+	SNAPSHOT_NODE_PRIVATE = 1 << 3,
+	SNAPSHOT_NODE_LOCKED = 1 << 4,
+	SNAPSHOT_NODE_MARKED = 1 << 5,
+	SNAPSHOT_NODE_PRESEL = 1 << 6,
+	SNAPSHOT_NODE_CLIENT = 1 << 7,
+	SNAPSHOT_NODE_FIRST_CHILD = 1 << 8,
+	SNAPSHOT_NODE_SECOND_CHILD = 1 << 9
+} snapshot_node_flags_t;
+
+typedef struct {
+	uint8_t *data;
+	size_t len;
+	size_t size;
+	size_t record;
+	bool failed;
+} snapshot_writer_t;
+
+typedef struct {
+	const uint8_t *data;
+	size_t pos;
+	size_t end;
+	size_t len;
+} snapshot_reader_t;
+
+typedef struct {
+	uint32_t id;
+	monitor_t *monitor;
+	desktop_t *desktop;
+	node_t *node;
+} snapshot_entry_t;
+
+typedef struct {
+	snapshot_entry_t *entries;
+	size_t len;
+	size_t size;
+	bool sorted;
+} snapshot_index_t;
+
+typedef struct {
+	monitor_t *mon;
+	monitor_t *mon_head;
+	monitor_t *mon_tail;
+	monitor_t *pri_mon;
+	history_t *history_head;
+	history_t *history_tail;
+	history_t *history_needle;
+	stacking_list_t *stack_head;
+	stacking_list_t *stack_tail;
+	uint32_t clients_count;
+} snapshot_state_t;
+
+bool is_snapshot(const char *data, size_t len);
+bool check_snapshot(const char *data, size_t len);
+void write_snapshot(snapshot_writer_t *w);
+bool save_snapshot(const char *file_path);
+bool restore_snapshot(const char *data, size_t len);
+void detach_state(snapshot_state_t *s);
+void attach_state(snapshot_state_t *s);
+void load_subscribers(const char *data, size_t len);
+void discard_snapshot(void);
+bool load_snapshot(const char *data, size_t len);
+bool print_snapshot(const char *file_path, FILE *rsp);
+
+void write_monitor(snapshot_writer_t *w, monitor_t *m);
+void write_desktop(snapshot_writer_t *w, desktop_t *d);
+void write_node(snapshot_writer_t *w, node_t *n);
+void write_client(snapshot_writer_t *w, client_t *c);
+void write_history(snapshot_writer_t *w);
+void write_stack(snapshot_writer_t *w);
+void write_subscribers(snapshot_writer_t *w);
+void begin_record(snapshot_writer_t *w, snapshot_tag_t tag);
+void end_record(snapshot_writer_t *w);
+void put_bytes(snapshot_writer_t *w, const void *data, size_t len);
+void put_u8(snapshot_writer_t *w, uint8_t v);
+void put_u16(snapshot_writer_t *w, uint16_t v);
+void put_u32(snapshot_writer_t *w, uint32_t v);
+void put_i32(snapshot_writer_t *w, int32_t v);
+void put_double(snapshot_writer_t *w, double v);
+void put_string(snapshot_writer_t *w, const char *s);
+void put_rect(snapshot_writer_t *w, xcb_rectangle_t r);
+void put_padding(snapshot_writer_t *w, padding_t p);
+
+monitor_t *read_monitor(snapshot_reader_t *r, uint32_t *focused_desktop_id);
+desktop_t *read_desktop(snapshot_reader_t *r, monitor_t *m, snapshot_index_t *idx);
+node_t *read_node(snapshot_reader_t *r, monitor_t *m, desktop_t *d, snapshot_index_t *idx);
+client_t *read_client(snapshot_reader_t *r);
+void read_history(snapshot_reader_t *r, snapshot_index_t *idx);
+void read_stack(snapshot_reader_t *r, snapshot_index_t *idx);
+void read_subscriber(snapshot_reader_t *r);
+bool next_record(snapshot_reader_t *r, snapshot_tag_t *tag);
+bool expect_record(snapshot_reader_t *r, snapshot_tag_t tag);
+void get_bytes(snapshot_reader_t *r, void *data, size_t len);
+uint8_t get_u8(snapshot_reader_t *r);
+uint16_t get_u16(snapshot_reader_t *r);
+uint32_t get_u32(snapshot_reader_t *r);
+int32_t get_i32(snapshot_reader_t *r);
+double get_double(snapshot_reader_t *r);
+void get_string(snapshot_reader_t *r, char *buf, size_t size);
+xcb_rectangle_t get_rect(snapshot_reader_t *r);
+padding_t get_padding(snapshot_reader_t *r);
+void index_add(snapshot_index_t *idx, uint32_t id, monitor_t *m, desktop_t *d, node_t *n);
+snapshot_entry_t *index_find(snapshot_index_t *idx, uint32_t id);
+int entry_cmp(const void *a, const void *b);
+
+#endif
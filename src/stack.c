@@ -27,6 +27,7 @@
 #include "window.h"
 #include "subscribe.h"
 #include "ewmh.h"
+#include "trace.h"
 #include "tree.h"
 #include "stack.h"
 
@@ -164,6 +165,8 @@ stacking_list_t *limit_below(node_t *n)
 
 void stack(desktop_t *d, node_t *n, bool focused)
 {
+	uint64_t start = trace_begin();
+
 	for (node_t *f = first_extrema(n); f != NULL; f = next_leaf(f, n)) {
 		if (f->client == NULL || (IS_FLOATING(f->client) && !auto_raise)) {
 			continue;
@@ -179,24 +182,74 @@ void stack(desktop_t *d, node_t *n, bool focused)
 			int i = stack_cmp(f->client, s->node->client);
 			if (i < 0 || (i == 0 && !focused)) {
 				stack_insert_before(s, f);
-				window_below(f->id, s->node->id);
+				stack_window(s->prev, s, false);
 				put_status(SBSC_MASK_NODE_STACK, "node_stack 0x%08X below 0x%08X\n", f->id, s->node->id);
 			} else {
 				stack_insert_after(s, f);
-				window_above(f->id, s->node->id);
+				stack_window(s->next, s, true);
 				put_status(SBSC_MASK_NODE_STACK, "node_stack 0x%08X above 0x%08X\n", f->id, s->node->id);
 			}
 		}
 	}
 
 	ewmh_update_client_list(true);
-	restack_presel_feedbacks(d);
+
+	/* the feedbacks of hidden desktops are restacked when they're shown */
+	for (monitor_t *m = mon_head; m != NULL; m = m->next) {
+		if (m->desk == d) {
+			restack_presel_feedbacks(d);
+			break;
+		}
+	}
+
+	trace_end("stack", NULL, start);
+}
+
+void stack_window(stacking_list_t *e, stacking_list_t *s, bool above)
+{
+	xcb_window_t container = e->node->client->container;
+	if (s->node->client->container == container) {
+		if (above) {
+			window_above(e->node->id, s->node->id);
+		} else {
+			window_below(e->node->id, s->node->id);
+		}
+		return;
+	}
+	/* Only siblings can be stacked relatively to each other */
+	for (stacking_list_t *t = e->prev; t != NULL; t = t->prev) {
+		if (t->node->client->container == container) {
+			window_above(e->node->id, t->node->id);
+			return;
+		}
+	}
+	for (stacking_list_t *t = e->next; t != NULL; t = t->next) {
+		if (t->node->client->container == container) {
+			window_below(e->node->id, t->node->id);
+			return;
+		}
+	}
+}
+
+void restack_windows(void)
+{
+	for (stacking_list_t *s = stack_head; s != NULL; s = s->next) {
+		for (stacking_list_t *t = s->prev; t != NULL; t = t->prev) {
+			if (t->node->client->container == s->node->client->container) {
+				window_above(s->node->id, t->node->id);
+				break;
+			}
+		}
+	}
 }
 
 void restack_presel_feedbacks(desktop_t *d)
 {
+	if (d == NULL) {
+		return;
+	}
 	stacking_list_t *s = stack_tail;
-	while (s != NULL && !IS_TILED(s->node->client)) {
+	while (s != NULL && (!IS_TILED(s->node->client) || s->node->client->container != d->container)) {
 		s = s->prev;
 	}
 	if (s != NULL) {
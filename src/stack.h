@@ -35,6 +35,8 @@ int stack_cmp(client_t *c1, client_t *c2);
 stacking_list_t *limit_above(node_t *n);
 stacking_list_t *limit_below(node_t *n);
 void stack(desktop_t *d, node_t *n, bool focused);
+void stack_window(stacking_list_t *e, stacking_list_t *s, bool above);
+void restack_windows(void);
 void restack_presel_feedbacks(desktop_t *d);
 void restack_presel_feedbacks_in(node_t *r, node_t *n);
 
@@ -0,0 +1,371 @@
+/* Copyright (c) 2012, Bastien Dejean
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <xcb/xcb_event.h>
+#include "helpers.h"
+#include "stats.h"
+#include "trace.h"
+
+histogram_t external_rules_latency;
+histogram_t monitors_settle_latency;
+uint64_t external_rules_timeouts;
+uint64_t adoption_count;
+uint64_t adoption_duration;
+uint64_t pointer_round_trips_saved;
+uint64_t pointer_motion_time;
+uint64_t drag_count;
+uint64_t drag_frames;
+uint64_t drag_dropped;
+uint64_t last_drag_frames;
+uint64_t last_drag_dropped;
+uint64_t layout_configures;
+uint64_t arranges_deferred;
+uint64_t resize_steps;
+uint64_t screen_changes_coalesced;
+histogram_t *event_latency[EVENT_TYPES];
+command_latency_t *command_latency_head;
+x_usage_t x_usage;
+x_usage_t *command_usage;
+caller_usage_t *caller_usage_head;
+uint64_t wait_start;
+
+unsigned int histogram_index(uint64_t v)
+{
+	if (v < HISTOGRAM_SUB) {
+		return v;
+	}
+	unsigned int e = 0;
+	while ((v >> e) >= 2 * HISTOGRAM_SUB) {
+		e++;
+	}
+	return (e + 1) * HISTOGRAM_SUB + (v >> e) - HISTOGRAM_SUB;
+}
+
+uint64_t histogram_lower_bound(unsigned int i)
+{
+	if (i < HISTOGRAM_SUB) {
+		return i;
+	}
+	unsigned int e = i / HISTOGRAM_SUB - 1;
+	return (uint64_t) (HISTOGRAM_SUB + i % HISTOGRAM_SUB) << e;
+}
+
+void histogram_add(histogram_t *h, uint64_t v)
+{
+	h->buckets[histogram_index(v)]++;
+	h->count++;
+	h->sum += v;
+	if (v > h->max) {
+		h->max = v;
+	}
+}
+
+/* Returns the upper bound of the bucket holding the given percentile. */
+uint64_t histogram_percentile(histogram_t *h, double p)
+{
+	if (h->count == 0) {
+		return 0;
+	}
+	double r = p * h->count / 100;
+	uint64_t rank = r;
+	if (rank < r || rank == 0) {
+		rank++;
+	}
+	uint64_t seen = 0;
+	for (unsigned int i = 0; i < HISTOGRAM_BUCKETS - 1; i++) {
+		seen += h->buckets[i];
+		if (seen >= rank) {
+			uint64_t v = histogram_lower_bound(i + 1) - 1;
+			return v < h->max ? v : h->max;
+		}
+	}
+	return h->max;
+}
+
+void print_histogram(histogram_t *h, FILE *rsp)
+{
+	fprintf(rsp, "{\"count\":%llu,\"mean\":%llu,\"p50\":%llu,\"p90\":%llu,\"p99\":%llu,\"max\":%llu}",
+	        (unsigned long long) h->count,
+	        (unsigned long long) (h->count > 0 ? h->sum / h->count : 0),
+	        (unsigned long long) histogram_percentile(h, 50),
+	        (unsigned long long) histogram_percentile(h, 90),
+	        (unsigned long long) histogram_percentile(h, 99),
+	        (unsigned long long) h->max);
+}
+
+/* The histograms are allocated on first use. */
+void add_event_latency(uint8_t type, uint64_t duration)
+{
+	type &= EVENT_TYPES - 1;
+	if (event_latency[type] == NULL) {
+		event_latency[type] = calloc(1, sizeof(histogram_t));
+		if (event_latency[type] == NULL) {
+			return;
+		}
+	}
+	histogram_add(event_latency[type], duration / 1000);
+}
+
+/* Commands are keyed by their domain and their first option, e.g. `node -f`.
+ * Unknown domains share one key, and so do the commands seen once the table is
+ * full, since the arguments come straight from the clients. Values, such as
+ * negative numbers, aren't options. */
+void get_command_key(char **args, int num, char *key, size_t len)
+{
+	if (!streq("node", args[0]) && !streq("desktop", args[0]) && !streq("monitor", args[0]) &&
+	    !streq("query", args[0]) && !streq("subscribe", args[0]) && !streq("wm", args[0]) &&
+	    !streq("rule", args[0]) && !streq("config", args[0]) && !streq("quit", args[0])) {
+		snprintf(key, len, "%s", COMMAND_KEY_OTHER);
+		return;
+	}
+	int i = 1;
+	while (i < num && !(args[i][0] == '-' && isalpha((unsigned char) args[i][strspn(args[i], "-")]))) {
+		i++;
+	}
+	if (i < num) {
+		snprintf(key, len, "%s %s", args[0], args[i]);
+	} else {
+		snprintf(key, len, "%s", args[0]);
+	}
+}
+
+command_latency_t *get_command_latency(const char *key)
+{
+	unsigned int count = 0;
+	command_latency_t *c = command_latency_head;
+	while (c != NULL && strcmp(c->key, key) != 0) {
+		c = c->next;
+		count++;
+	}
+	if (c != NULL) {
+		return c;
+	}
+	if (count >= COMMAND_KEYS_MAX && !streq(key, COMMAND_KEY_OTHER)) {
+		return get_command_latency(COMMAND_KEY_OTHER);
+	}
+	c = calloc(1, sizeof(command_latency_t));
+	if (c == NULL) {
+		return NULL;
+	}
+	snprintf(c->key, sizeof(c->key), "%s", key);
+	c->next = command_latency_head;
+	command_latency_head = c;
+	return c;
+}
+
+void add_command_latency(char **args, int num, uint64_t duration, x_usage_t *usage)
+{
+	char key[LATENCY_KEY_LEN];
+	get_command_key(args, num, key, sizeof(key));
+
+	command_latency_t *c = get_command_latency(key);
+	if (c == NULL) {
+		return;
+	}
+	histogram_add(&c->histogram, duration / 1000);
+	c->usage.requests += usage->requests;
+	c->usage.replies += usage->replies;
+	c->usage.blocked += usage->blocked;
+}
+
+/* Callers are the functions issuing the requests, as given by `__func__`,
+ * hence compared by address. */
+caller_usage_t *get_caller_usage(const char *caller)
+{
+	caller_usage_t *c = caller_usage_head;
+	while (c != NULL && c->caller != caller) {
+		c = c->next;
+	}
+	if (c == NULL) {
+		c = calloc(1, sizeof(caller_usage_t));
+		if (c == NULL) {
+			return NULL;
+		}
+		c->caller = caller;
+		c->next = caller_usage_head;
+		caller_usage_head = c;
+	}
+	return c;
+}
+
+void count_request(const char *caller)
+{
+	x_usage.requests++;
+	if (command_usage != NULL) {
+		command_usage->requests++;
+	}
+	caller_usage_t *c = get_caller_usage(caller);
+	if (c != NULL) {
+		c->usage.requests++;
+	}
+}
+
+void begin_wait(void)
+{
+	wait_start = get_time_ns();
+}
+
+void end_wait(const char *caller)
+{
+	uint64_t blocked = get_time_ns() - wait_start;
+	x_usage.replies++;
+	x_usage.blocked += blocked;
+	if (command_usage != NULL) {
+		command_usage->replies++;
+		command_usage->blocked += blocked;
+	}
+	caller_usage_t *c = get_caller_usage(caller);
+	if (c != NULL) {
+		c->usage.replies++;
+		c->usage.blocked += blocked;
+	}
+	trace_end("round_trip", caller, wait_start);
+}
+
+void *end_wait_reply(const char *caller, void *reply)
+{
+	end_wait(caller);
+	return reply;
+}
+
+uint8_t end_wait_status(const char *caller, uint8_t status)
+{
+	end_wait(caller);
+	return status;
+}
+
+void print_key(const char *key, FILE *rsp)
+{
+	fprintf(rsp, "\"");
+	for (const char *k = key; *k != '\0'; k++) {
+		if (*k == '"' || *k == '\\') {
+			fputc('\\', rsp);
+		}
+		fputc(*k, rsp);
+	}
+	fprintf(rsp, "\":");
+}
+
+void print_usage(x_usage_t *u, FILE *rsp)
+{
+	fprintf(rsp, "{\"requests\":%llu,\"replies\":%llu,\"blocked\":%llu}",
+	        (unsigned long long) u->requests, (unsigned long long) u->replies,
+	        (unsigned long long) u->blocked / 1000);
+}
+
+/* Latencies are in microseconds. */
+void print_stats(FILE *rsp)
+{
+	fprintf(rsp, "{\"externalRules\":{\"latency\":");
+	print_histogram(&external_rules_latency, rsp);
+	fprintf(rsp, ",\"timeouts\":%llu}", (unsigned long long) external_rules_timeouts);
+	fprintf(rsp, ",\"adoption\":{\"windows\":%llu,\"duration\":%llu}",
+	        (unsigned long long) adoption_count, (unsigned long long) adoption_duration);
+	fprintf(rsp, ",\"pointer\":{\"savedRoundTrips\":%llu,\"motionDuration\":%llu,\"savedPerSecond\":%.1f}",
+	        (unsigned long long) pointer_round_trips_saved, (unsigned long long) pointer_motion_time * 1000,
+	        pointer_motion_time > 0 ? 1000.0 * pointer_round_trips_saved / pointer_motion_time : 0.0);
+	fprintf(rsp, ",\"drag\":{\"count\":%llu,\"frames\":%llu,\"dropped\":%llu,\"last\":{\"frames\":%llu,\"dropped\":%llu}}",
+	        (unsigned long long) drag_count, (unsigned long long) drag_frames, (unsigned long long) drag_dropped,
+	        (unsigned long long) last_drag_frames, (unsigned long long) last_drag_dropped);
+	fprintf(rsp, ",\"layout\":{\"configureRequests\":%llu,\"tiledResizes\":%llu,\"deferredArranges\":%llu}",
+	        (unsigned long long) layout_configures, (unsigned long long) resize_steps,
+	        (unsigned long long) arranges_deferred);
+	fprintf(rsp, ",\"monitors\":{\"settleLatency\":");
+	print_histogram(&monitors_settle_latency, rsp);
+	fprintf(rsp, ",\"coalescedChanges\":%llu}", (unsigned long long) screen_changes_coalesced);
+	fprintf(rsp, ",\"events\":{");
+	bool first = true;
+	for (unsigned int i = 0; i < EVENT_TYPES; i++) {
+		if (event_latency[i] == NULL) {
+			continue;
+		}
+		const char *label = xcb_event_get_label(i);
+		if (label != NULL) {
+			fprintf(rsp, "%s\"%s\":", first ? "" : ",", label);
+		} else {
+			fprintf(rsp, "%s\"%u\":", first ? "" : ",", i);
+		}
+		print_histogram(event_latency[i], rsp);
+		first = false;
+	}
+	fprintf(rsp, "},\"commands\":{");
+	for (command_latency_t *c = command_latency_head; c != NULL; c = c->next) {
+		print_key(c->key, rsp);
+		print_histogram(&c->histogram, rsp);
+		if (c->next != NULL) {
+			fprintf(rsp, ",");
+		}
+	}
+	fprintf(rsp, "},\"requests\":{\"total\":");
+	print_usage(&x_usage, rsp);
+	fprintf(rsp, ",\"callers\":{");
+	for (caller_usage_t *c = caller_usage_head; c != NULL; c = c->next) {
+		print_key(c->caller, rsp);
+		print_usage(&c->usage, rsp);
+		if (c->next != NULL) {
+			fprintf(rsp, ",");
+		}
+	}
+	fprintf(rsp, "},\"commands\":{");
+	for (command_latency_t *c = command_latency_head; c != NULL; c = c->next) {
+		print_key(c->key, rsp);
+		print_usage(&c->usage, rsp);
+		if (c->next != NULL) {
+			fprintf(rsp, ",");
+		}
+	}
+	fprintf(rsp, "}}}");
+}
+
+void reset_stats(void)
+{
+	memset(&external_rules_latency, 0, sizeof(histogram_t));
+	memset(&monitors_settle_latency, 0, sizeof(histogram_t));
+	external_rules_timeouts = 0;
+	adoption_count = adoption_duration = 0;
+	pointer_round_trips_saved = pointer_motion_time = 0;
+	drag_count = drag_frames = drag_dropped = 0;
+	last_drag_frames = last_drag_dropped = 0;
+	layout_configures = arranges_deferred = resize_steps = 0;
+	screen_changes_coalesced = 0;
+	for (unsigned int i = 0; i < EVENT_TYPES; i++) {
+		free(event_latency[i]);
+		event_latency[i] = NULL;
+	}
+	while (command_latency_head != NULL) {
+		command_latency_t *next = command_latency_head->next;
+		free(command_latency_head);
+		command_latency_head = next;
+	}
+	memset(&x_usage, 0, sizeof(x_usage_t));
+	while (caller_usage_head != NULL) {
+		caller_usage_t *next = caller_usage_head->next;
+		free(caller_usage_head);
+		caller_usage_head = next;
+	}
+}
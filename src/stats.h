@@ -0,0 +1,112 @@
+/* Copyright (c) 2012, Bastien Dejean
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef BSPWM_STATS_H
+#define BSPWM_STATS_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+/* The first HISTOGRAM_SUB buckets hold one value each, then every power of two
+ * is split into HISTOGRAM_SUB buckets, hence a relative error below 1/8. */
+#define HISTOGRAM_SUB      8
+#define HISTOGRAM_BUCKETS  (62 * HISTOGRAM_SUB)
+#define EVENT_TYPES        128
+#define LATENCY_KEY_LEN    32
+#define COMMAND_KEYS_MAX   128
+#define COMMAND_KEY_OTHER  "other"
+
+typedef struct {
+	uint64_t count;
+	uint64_t sum;
+	uint64_t max;
+	uint64_t buckets[HISTOGRAM_BUCKETS];
+} histogram_t;
+
+typedef struct {
+	uint64_t requests;
+	uint64_t replies;
+	uint64_t blocked;
+} x_usage_t;
+
+typedef struct caller_usage_t caller_usage_t;
+struct caller_usage_t {
+	const char *caller;
+	x_usage_t usage;
+	caller_usage_t *next;
+};
+
+typedef struct command_latency_t command_latency_t;
+struct command_latency_t {
+	char key[LATENCY_KEY_LEN];
+	histogram_t histogram;
+	x_usage_t usage;
+	command_latency_t *next;
+};
+
+extern histogram_t external_rules_latency;
+extern histogram_t monitors_settle_latency;
+extern uint64_t external_rules_timeouts;
+extern uint64_t adoption_count;
+extern uint64_t adoption_duration;
+extern uint64_t pointer_round_trips_saved;
+extern uint64_t pointer_motion_time;
+extern uint64_t drag_count;
+extern uint64_t drag_frames;
+extern uint64_t drag_dropped;
+extern uint64_t last_drag_frames;
+extern uint64_t last_drag_dropped;
+extern uint64_t layout_configures;
+extern uint64_t arranges_deferred;
+extern uint64_t resize_steps;
+extern uint64_t screen_changes_coalesced;
+extern histogram_t *event_latency[EVENT_TYPES];
+extern command_latency_t *command_latency_head;
+extern x_usage_t x_usage;
+extern x_usage_t *command_usage;
+extern caller_usage_t *caller_usage_head;
+extern uint64_t wait_start;
+
+unsigned int histogram_index(uint64_t v);
+uint64_t histogram_lower_bound(unsigned int i);
+void histogram_add(histogram_t *h, uint64_t v);
+uint64_t histogram_percentile(histogram_t *h, double p);
+void print_histogram(histogram_t *h, FILE *rsp);
+void add_event_latency(uint8_t type, uint64_t duration);
+void get_command_key(char **args, int num, char *key, size_t len);
+command_latency_t *get_command_latency(const char *key);
+void add_command_latency(char **args, int num, uint64_t duration, x_usage_t *usage);
+caller_usage_t *get_caller_usage(const char *caller);
+void count_request(const char *caller);
+void begin_wait(void);
+void end_wait(const char *caller);
+void *end_wait_reply(const char *caller, void *reply);
+uint8_t end_wait_status(const char *caller, uint8_t status);
+void print_key(const char *key, FILE *rsp);
+void print_usage(x_usage_t *u, FILE *rsp);
+void print_stats(FILE *rsp);
+void reset_stats(void);
+
+#endif
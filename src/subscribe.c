@@ -26,12 +26,14 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <ctype.h>
+#include <string.h>
 #include <stdarg.h>
 #include <fcntl.h>
 #include "bspwm.h"
 #include "desktop.h"
 #include "settings.h"
 #include "subscribe.h"
+#include "trace.h"
 #include "tree.h"
 
 subscriber_list_t *make_subscriber(FILE *stream, char *fifo_path, int field, int count)
@@ -64,6 +66,9 @@ void remove_subscriber(subscriber_list_t *sb)
 	if (sb == subscribe_tail) {
 		subscribe_tail = a;
 	}
+	while (sb->queue_head != NULL) {
+		dequeue_event(sb, sb->queue_head);
+	}
 	if (restart) {
 		int cli_fd = fileno(sb->stream);
 		fcntl(cli_fd, F_SETFD, ~FD_CLOEXEC & fcntl(cli_fd, F_GETFD));
@@ -144,25 +149,238 @@ int print_report(FILE *stream)
 void put_status(subscriber_mask_t mask, ...)
 {
 	subscriber_list_t *sb = subscribe_head;
+	const char *layout = event_ids_layout(mask);
+	uint32_t ids[MAX_EVENT_IDS];
+	uint64_t now = 0;
+	uint64_t start = trace_begin();
+	const char *fmt = NULL;
 	int ret;
+
+	if (layout[0] != '\0') {
+		va_list args;
+		va_start(args, mask);
+		fmt = va_arg(args, char *);
+		for (int i = 0; layout[i] != '\0'; i++) {
+			ids[i] = va_arg(args, unsigned int);
+		}
+		va_end(args);
+	}
+
 	while (sb != NULL) {
 		subscriber_list_t *next = sb->next;
-		if (sb->field & mask) {
-			if (sb->count > 0) {
-				sb->count--;
+		if ((sb->field & mask) && event_matches(sb, layout, ids)) {
+			bool throttled = (sb->max_rate > 0 || (sb->coalesce & mask));
+			if (throttled && now == 0) {
+				now = get_time_ns();
 			}
-			if (mask == SBSC_MASK_REPORT) {
-				ret = print_report(sb->stream);
+			if (sb->queue_head != NULL || (throttled && now < sb->next_flush)) {
+				char *text = NULL;
+				if (mask == SBSC_MASK_REPORT) {
+					size_t len;
+					FILE *stream = open_memstream(&text, &len);
+					if (stream != NULL) {
+						print_report(stream);
+						fclose(stream);
+					}
+				} else {
+					char *fmt;
+					va_list args;
+					va_start(args, mask);
+					fmt = va_arg(args, char *);
+					if (vasprintf(&text, fmt, args) == -1) {
+						text = NULL;
+					}
+					va_end(args);
+				}
+				if (text != NULL) {
+					queue_event(sb, mask, event_key(layout, ids), text);
+				}
 			} else {
-				char *fmt;
-				va_list args;
-				va_start(args, mask);
-				fmt = va_arg(args, char *);
-				vfprintf(sb->stream, fmt, args);
-				va_end(args);
-				ret = fflush(sb->stream);
+				if (throttled) {
+					sb->next_flush = now + flush_interval(sb);
+				}
+				if (sb->count > 0) {
+					sb->count--;
+				}
+				if (mask == SBSC_MASK_REPORT) {
+					ret = print_report(sb->stream);
+				} else {
+					char *fmt;
+					va_list args;
+					va_start(args, mask);
+					fmt = va_arg(args, char *);
+					vfprintf(sb->stream, fmt, args);
+					va_end(args);
+					ret = fflush(sb->stream);
+				}
+				if (ret != 0 || sb->count == 0) {
+					remove_subscriber(sb);
+				}
 			}
-			if (ret != 0 || sb->count == 0) {
+		}
+		sb = next;
+	}
+
+	if (tracing) {
+		char event[TRACE_DETAIL_LEN] = "report";
+		if (fmt != NULL) {
+			snprintf(event, sizeof(event), "%.*s", (int) strcspn(fmt, " \n"), fmt);
+		}
+		trace_end("put_status", event, start);
+	}
+}
+
+const char *event_ids_layout(subscriber_mask_t mask)
+{
+	switch (mask) {
+		case SBSC_MASK_MONITOR_ADD:
+		case SBSC_MASK_MONITOR_RENAME:
+		case SBSC_MASK_MONITOR_REMOVE:
+		case SBSC_MASK_MONITOR_FOCUS:
+		case SBSC_MASK_MONITOR_GEOMETRY:
+			return "m";
+		case SBSC_MASK_MONITOR_SWAP:
+			return "mm";
+		case SBSC_MASK_DESKTOP_SWAP:
+			return "mdmd";
+		case SBSC_MASK_DESKTOP_TRANSFER:
+			return "mdm";
+		case SBSC_MASK_NODE_ADD:
+			return "mdnn";
+		case SBSC_MASK_NODE_SWAP:
+		case SBSC_MASK_NODE_TRANSFER:
+			return "mdnmdn";
+		case SBSC_MASK_NODE_STACK:
+			return "nn";
+		default:
+			if (mask & SBSC_MASK_DESKTOP) {
+				return "md";
+			} else if (mask & (SBSC_MASK_NODE | SBSC_MASK_POINTER_ACTION)) {
+				return "mdn";
+			}
+			return "";
+	}
+}
+
+bool event_matches(subscriber_list_t *sb, const char *layout, uint32_t *ids)
+{
+	if (sb->monitor_id == 0 && sb->desktop_id == 0 && sb->node_id == 0) {
+		return true;
+	}
+
+	bool has_monitor = false, has_desktop = false, has_node = false;
+	bool match_monitor = false, match_desktop = false, match_node = false;
+
+	for (int i = 0; layout[i] != '\0'; i++) {
+		if (layout[i] == 'm') {
+			has_monitor = true;
+			match_monitor = match_monitor || ids[i] == sb->monitor_id;
+		} else if (layout[i] == 'd') {
+			has_desktop = true;
+			match_desktop = match_desktop || ids[i] == sb->desktop_id;
+		} else if (layout[i] == 'n') {
+			has_node = true;
+			match_node = match_node || ids[i] == sb->node_id;
+		}
+	}
+
+	return (sb->monitor_id == 0 || !has_monitor || match_monitor) &&
+	       (sb->desktop_id == 0 || !has_desktop || match_desktop) &&
+	       (sb->node_id == 0 || !has_node || match_node);
+}
+
+uint32_t event_key(const char *layout, uint32_t *ids)
+{
+	const char *kinds = "ndm";
+	for (int k = 0; kinds[k] != '\0'; k++) {
+		for (int i = 0; layout[i] != '\0'; i++) {
+			if (layout[i] == kinds[k]) {
+				return ids[i];
+			}
+		}
+	}
+	return 0;
+}
+
+void queue_event(subscriber_list_t *sb, subscriber_mask_t mask, uint32_t key, char *text)
+{
+	if (sb->coalesce & mask) {
+		for (queued_event_t *q = sb->queue_head; q != NULL; q = q->next) {
+			if (q->mask == (int) mask && q->key == key) {
+				dequeue_event(sb, q);
+				sb->coalesced++;
+				break;
+			}
+		}
+	}
+
+	if (sb->queue_len >= QUEUE_MAX_LEN) {
+		dequeue_event(sb, sb->queue_head);
+		sb->dropped++;
+	}
+
+	queued_event_t *q = calloc(1, sizeof(queued_event_t));
+	if (q == NULL) {
+		free(text);
+		return;
+	}
+
+	q->mask = mask;
+	q->key = key;
+	q->text = text;
+
+	if (sb->queue_head == NULL) {
+		sb->queue_head = sb->queue_tail = q;
+	} else {
+		sb->queue_tail->next = q;
+		q->prev = sb->queue_tail;
+		sb->queue_tail = q;
+	}
+	sb->queue_len++;
+}
+
+void dequeue_event(subscriber_list_t *sb, queued_event_t *q)
+{
+	queued_event_t *a = q->prev;
+	queued_event_t *b = q->next;
+	if (a != NULL) {
+		a->next = b;
+	}
+	if (b != NULL) {
+		b->prev = a;
+	}
+	if (q == sb->queue_head) {
+		sb->queue_head = b;
+	}
+	if (q == sb->queue_tail) {
+		sb->queue_tail = a;
+	}
+	sb->queue_len--;
+	free(q->text);
+	free(q);
+}
+
+uint64_t flush_interval(subscriber_list_t *sb)
+{
+	return 1000000000 / (sb->max_rate > 0 ? sb->max_rate : COALESCE_RATE);
+}
+
+void flush_subscribers(bool force)
+{
+	subscriber_list_t *sb = subscribe_head;
+	uint64_t now = get_time_ns();
+	while (sb != NULL) {
+		subscriber_list_t *next = sb->next;
+		if (sb->queue_head != NULL && (force || now >= sb->next_flush)) {
+			while (sb->queue_head != NULL && sb->count != 0) {
+				fprintf(sb->stream, "%s", sb->queue_head->text);
+				if (sb->count > 0) {
+					sb->count--;
+				}
+				dequeue_event(sb, sb->queue_head);
+			}
+			sb->next_flush = now + flush_interval(sb);
+			if (fflush(sb->stream) != 0 || sb->count == 0) {
 				remove_subscriber(sb);
 			}
 		}
@@ -170,6 +388,17 @@ void put_status(subscriber_mask_t mask, ...)
 	}
 }
 
+uint64_t subscribers_deadline(void)
+{
+	uint64_t deadline = 0;
+	for (subscriber_list_t *sb = subscribe_head; sb != NULL; sb = sb->next) {
+		if (sb->queue_head != NULL && (deadline == 0 || sb->next_flush < deadline)) {
+			deadline = sb->next_flush;
+		}
+	}
+	return deadline;
+}
+
 void prune_dead_subscribers(void)
 {
 	subscriber_list_t *sb = subscribe_head;
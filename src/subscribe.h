@@ -26,6 +26,9 @@
 #define BSPWM_SUBSCRIBE_H
 
 #define FIFO_TEMPLATE  "bspwm_fifo.XXXXXX"
+#define MAX_EVENT_IDS  6
+#define COALESCE_RATE  60
+#define QUEUE_MAX_LEN  1024
 
 typedef enum {
 	SBSC_MASK_REPORT = 1 << 0,
@@ -68,6 +71,25 @@ void add_subscriber(subscriber_list_t *sb);
 int print_report(FILE *stream);
 void put_status(subscriber_mask_t mask, ...);
 
+/* Returns the kinds ('m', 'd' or 'n') of the identifiers that come first in
+ * the arguments of the events of the given type. */
+const char *event_ids_layout(subscriber_mask_t mask);
+
+/* Events that don't refer to a given kind of object aren't filtered by it. */
+bool event_matches(subscriber_list_t *sb, const char *layout, uint32_t *ids);
+
+/* Subscribers with a maximum rate or coalesced events receive the first event
+ * of each interval immediately, the following ones are queued until the end
+ * of the interval. Only the latest coalesced event per type and object is
+ * kept in the queue. While the queue isn't empty, every event goes through it
+ * to preserve their order, and the oldest events are dropped when it is full. */
+uint32_t event_key(const char *layout, uint32_t *ids);
+void queue_event(subscriber_list_t *sb, subscriber_mask_t mask, uint32_t key, char *text);
+void dequeue_event(subscriber_list_t *sb, queued_event_t *q);
+uint64_t flush_interval(subscriber_list_t *sb);
+void flush_subscribers(bool force);
+uint64_t subscribers_deadline(void);
+
 /* Remove any subscriber for which the stream has been closed and is no longer
  * writable. */
 void prune_dead_subscribers(void);
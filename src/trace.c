@@ -0,0 +1,143 @@
+/* Copyright (c) 2012, Bastien Dejean
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "bspwm.h"
+#include "trace.h"
+
+bool tracing;
+trace_buffer_t trace_buffer;
+
+bool trace_start(const char *path)
+{
+	if (tracing) {
+		trace_stop();
+	}
+
+	trace_buffer.spans = malloc(TRACE_CAPACITY * sizeof(trace_span_t));
+	trace_buffer.path = strdup(path);
+
+	if (trace_buffer.spans == NULL || trace_buffer.path == NULL) {
+		free(trace_buffer.spans);
+		free(trace_buffer.path);
+		trace_buffer.spans = NULL;
+		trace_buffer.path = NULL;
+		return false;
+	}
+
+	trace_buffer.count = 0;
+	trace_buffer.origin = get_time_ns();
+	tracing = true;
+
+	return true;
+}
+
+bool trace_stop(void)
+{
+	if (!tracing) {
+		return false;
+	}
+
+	tracing = false;
+
+	bool success = false;
+	FILE *f = fopen(trace_buffer.path, "w");
+
+	if (f != NULL) {
+		trace_write(f);
+		success = (fclose(f) == 0);
+	} else {
+		warn("Trace: can't open '%s'.\n", trace_buffer.path);
+	}
+
+	free(trace_buffer.spans);
+	free(trace_buffer.path);
+	trace_buffer.spans = NULL;
+	trace_buffer.path = NULL;
+
+	return success;
+}
+
+uint64_t trace_begin(void)
+{
+	return tracing ? get_time_ns() : 0;
+}
+
+void trace_end(const char *name, const char *detail, uint64_t start)
+{
+	if (!tracing || start == 0) {
+		return;
+	}
+
+	/* spans that began before the trace was started are clipped */
+	start = MAX(start, trace_buffer.origin);
+
+	trace_span_t *s = &trace_buffer.spans[trace_buffer.count % TRACE_CAPACITY];
+	s->name = name;
+	s->start = start;
+	s->duration = get_time_ns() - start;
+	if (detail != NULL) {
+		snprintf(s->detail, sizeof(s->detail), "%s", detail);
+	} else {
+		s->detail[0] = '\0';
+	}
+	trace_buffer.count++;
+}
+
+void trace_write(FILE *f)
+{
+	uint64_t first = trace_buffer.count > TRACE_CAPACITY ? trace_buffer.count - TRACE_CAPACITY : 0;
+	int pid = getpid();
+
+	fprintf(f, "{\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped\":%llu},\"traceEvents\":[", (unsigned long long) first);
+	fprintf(f, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%i,\"tid\":%i,\"args\":{\"name\":\"%s\"}}", pid, pid, WM_NAME);
+
+	for (uint64_t i = first; i < trace_buffer.count; i++) {
+		trace_span_t *s = &trace_buffer.spans[i % TRACE_CAPACITY];
+		uint64_t ts = s->start - trace_buffer.origin;
+		fprintf(f, ",{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%i,\"tid\":%i,\"ts\":%llu.%03u,\"dur\":%llu.%03u",
+		        s->name, pid, pid, (unsigned long long) ts / 1000, (unsigned int) (ts % 1000),
+		        (unsigned long long) s->duration / 1000, (unsigned int) (s->duration % 1000));
+		if (s->detail[0] != '\0') {
+			fprintf(f, ",\"args\":{\"detail\":\"");
+			for (char *c = s->detail; *c != '\0'; c++) {
+				if (*c == '"' || *c == '\\') {
+					fprintf(f, "\\%c", *c);
+				} else if ((unsigned char) *c < 0x20) {
+					fprintf(f, "\\u%04x", *c);
+				} else {
+					fputc(*c, f);
+				}
+			}
+			fprintf(f, "\"}");
+		}
+		fprintf(f, "}");
+	}
+
+	fprintf(f, "]}\n");
+}
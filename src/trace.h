@@ -0,0 +1,63 @@
+/* Copyright (c) 2012, Bastien Dejean
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef BSPWM_TRACE_H
+#define BSPWM_TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/* Spans are recorded in a ring buffer allocated when tracing starts, the
+ * oldest ones are overwritten when it is full. They are written in the
+ * Chrome trace event format, which Perfetto reads, when tracing stops. */
+
+#define TRACE_CAPACITY    65536
+#define TRACE_DETAIL_LEN  32
+
+typedef struct {
+	const char *name;
+	char detail[TRACE_DETAIL_LEN];
+	uint64_t start;
+	uint64_t duration;
+} trace_span_t;
+
+typedef struct {
+	trace_span_t *spans;
+	uint64_t count;
+	uint64_t origin;
+	char *path;
+} trace_buffer_t;
+
+extern bool tracing;
+extern trace_buffer_t trace_buffer;
+
+bool trace_start(const char *path);
+bool trace_stop(void);
+uint64_t trace_begin(void);
+void trace_end(const char *name, const char *detail, uint64_t start);
+void trace_write(FILE *f);
+
+#endif
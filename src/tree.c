@@ -37,15 +37,27 @@
 #include "settings.h"
 #include "pointer.h"
 #include "stack.h"
+#include "stats.h"
+#include "trace.h"
 #include "window.h"
 #include "tree.h"
+#include "accounting.h"
 
 void arrange(monitor_t *m, desktop_t *d)
 {
+	/* the whole batch is arranged at once */
+	if (batch_updates) {
+		return;
+	}
+
+	d->stale = false;
+
 	if (d->root == NULL) {
 		return;
 	}
 
+	uint64_t start = trace_begin();
+
 	xcb_rectangle_t rect = m->rectangle;
 
 	rect.x += m->padding.left + d->padding.left;
@@ -68,6 +80,29 @@ void arrange(monitor_t *m, desktop_t *d)
 	}
 
 	apply_layout(m, d, d->root, rect, rect);
+
+	trace_end("arrange", d->name, start);
+}
+
+/* Only the given subtree is laid out again, within its current rectangle. */
+void arrange_subtree(monitor_t *m, desktop_t *d, node_t *n)
+{
+	if (d->root == NULL || batch_updates) {
+		return;
+	}
+
+	apply_layout(m, d, n, n->rectangle, d->root->rectangle);
+}
+
+void arrange_lazily(monitor_t *m, desktop_t *d)
+{
+	/* hidden desktops are arranged when they're shown */
+	if (d != m->desk && d->root != NULL && !batch_updates) {
+		d->stale = true;
+		arranges_deferred++;
+		return;
+	}
+	arrange(m, d);
 }
 
 void apply_layout(monitor_t *m, desktop_t *d, node_t *n, xcb_rectangle_t rect, xcb_rectangle_t root_rect)
@@ -76,6 +111,8 @@ void apply_layout(monitor_t *m, desktop_t *d, node_t *n, xcb_rectangle_t rect, x
 		return;
 	}
 
+	uint64_t start = trace_begin();
+
 	n->rectangle = rect;
 
 	if (n->presel != NULL) {
@@ -85,6 +122,7 @@ void apply_layout(monitor_t *m, desktop_t *d, node_t *n, xcb_rectangle_t rect, x
 	if (is_leaf(n)) {
 
 		if (n->client == NULL) {
+			trace_end("apply_layout", NULL, start);
 			return;
 		}
 
@@ -99,7 +137,8 @@ void apply_layout(monitor_t *m, desktop_t *d, node_t *n, xcb_rectangle_t rect, x
 		}
 
 		xcb_rectangle_t r;
-		xcb_rectangle_t cr = get_window_rectangle(n);
+		uint32_t cbw;
+		xcb_rectangle_t cr = get_window_rectangle(n, &cbw);
 		client_state_t s = n->client->state;
 		/* tiled and pseudo-tiled clients */
 		if (s == STATE_TILED || s == STATE_PSEUDO_TILED) {
@@ -132,12 +171,16 @@ void apply_layout(monitor_t *m, desktop_t *d, node_t *n, xcb_rectangle_t rect, x
 
 		if (!rect_eq(r, cr)) {
 			window_move_resize(n->id, r.x, r.y, r.width, r.height);
+			layout_configures++;
 			if (!grabbing) {
 				put_status(SBSC_MASK_NODE_GEOMETRY, "node_geometry 0x%08X 0x%08X 0x%08X %ux%u+%i+%i\n", m->id, d->id, n->id, r.width, r.height, r.x, r.y);
 			}
 		}
 
-		window_border_width(n->id, bw);
+		if (bw != cbw) {
+			window_border_width(n->id, bw);
+			layout_configures++;
+		}
 
 	} else {
 		xcb_rectangle_t first_rect;
@@ -179,6 +222,8 @@ void apply_layout(monitor_t *m, desktop_t *d, node_t *n, xcb_rectangle_t rect, x
 		apply_layout(m, d, n->first_child, first_rect, root_rect);
 		apply_layout(m, d, n->second_child, second_rect, root_rect);
 	}
+
+	trace_end("apply_layout", NULL, start);
 }
 
 presel_t *make_presel(void)
@@ -241,7 +286,7 @@ void cancel_presel(monitor_t *m, desktop_t *d, node_t *n)
 	}
 
 	if (n->presel->feedback != XCB_NONE) {
-		xcb_destroy_window(dpy, n->presel->feedback);
+		release_presel_feedback(n->presel->feedback);
 	}
 
 	free(n->presel);
@@ -637,7 +682,7 @@ bool focus_node(monitor_t *m, desktop_t *d, node_t *n)
 	}
 
 	if (m->desk != d) {
-		show_desktop(d);
+		show_desktop(m, d);
 		set_input_focus(n);
 		has_input_focus = true;
 		hide_desktop(m->desk);
@@ -684,11 +729,16 @@ void hide_node(desktop_t *d, node_t *n)
 		return;
 	} else {
 		if (!n->hidden) {
-			if (n->presel != NULL && d->layout != LAYOUT_MONOCLE) {
+			/* Windows inside a desktop container stay mapped */
+			if (n->presel != NULL && d->layout != LAYOUT_MONOCLE && d->container == XCB_NONE) {
 				window_hide(n->presel->feedback);
 			}
 			if (n->client != NULL) {
-				window_hide(n->id);
+				if (n->client->container != XCB_NONE) {
+					set_window_state(n->id, XCB_ICCCM_WM_STATE_ICONIC);
+				} else {
+					window_hide(n->id);
+				}
 			}
 		}
 		if (n->client != NULL) {
@@ -706,9 +756,13 @@ void show_node(desktop_t *d, node_t *n)
 	} else {
 		if (!n->hidden) {
 			if (n->client != NULL) {
-				window_show(n->id);
+				if (n->client->container != XCB_NONE) {
+					set_window_state(n->id, XCB_ICCCM_WM_STATE_NORMAL);
+				} else {
+					window_show(n->id);
+				}
 			}
-			if (n->presel != NULL && d->layout != LAYOUT_MONOCLE) {
+			if (n->presel != NULL && d->layout != LAYOUT_MONOCLE && d->container == XCB_NONE) {
 				window_show(n->presel->feedback);
 			}
 		}
@@ -720,6 +774,48 @@ void show_node(desktop_t *d, node_t *n)
 	}
 }
 
+void reparent_node(desktop_t *d, node_t *n)
+{
+	if (n == NULL) {
+		return;
+	}
+
+	xcb_window_t container = XCB_NONE;
+	if (d != NULL && desktop_containers) {
+		create_desktop_container(d);
+		container = d->container;
+	}
+	xcb_window_t parent = (container == XCB_NONE ? root : container);
+
+	/* Windows of hidden desktops are mapped inside their container */
+	if (n->client != NULL && n->client->container != container) {
+		xcb_rectangle_t rect = get_rectangle(NULL, NULL, n);
+		bool concealed = !n->client->shown && !n->hidden;
+		if (container == XCB_NONE && concealed) {
+			window_set_visibility_in(n->client->container, n->id, false);
+		}
+		window_reparent(n->id, window_parent(n->client), parent, rect.x, rect.y);
+		xcb_change_save_set(dpy, container == XCB_NONE ? XCB_SET_MODE_DELETE : XCB_SET_MODE_INSERT, n->id);
+		if (container != XCB_NONE && concealed) {
+			xcb_map_window(dpy, n->id);
+		}
+		n->client->container = container;
+	}
+
+	if (n->presel != NULL && n->presel->feedback != XCB_NONE && (d == NULL || container != XCB_NONE)) {
+		if (container == XCB_NONE) {
+			window_hide(n->presel->feedback);
+		}
+		xcb_reparent_window(dpy, n->presel->feedback, parent, 0, 0);
+		if (container != XCB_NONE && d->layout != LAYOUT_MONOCLE) {
+			xcb_map_window(dpy, n->presel->feedback);
+		}
+	}
+
+	reparent_node(d, n->first_child);
+	reparent_node(d, n->second_child);
+}
+
 node_t *make_node(uint32_t id)
 {
 	if (id == XCB_NONE) {
@@ -755,12 +851,13 @@ client_t *make_client(void)
 	return c;
 }
 
-void initialize_client(node_t *n)
+void initialize_client(node_t *n, window_props_t *wp)
 {
-	xcb_window_t win = n->id;
 	client_t *c = n->client;
 	xcb_icccm_get_wm_protocols_reply_t protos;
-	if (xcb_icccm_get_wm_protocols_reply(dpy, xcb_icccm_get_wm_protocols(dpy, win, ewmh->WM_PROTOCOLS), &protos, NULL) == 1) {
+	int ok = xcb_icccm_get_wm_protocols_reply(dpy, wp->protocols, &protos, NULL);
+	wp->protocols.sequence = 0;
+	if (ok == 1) {
 		for (uint32_t i = 0; i < protos.atoms_len; i++) {
 			if (protos.atoms[i] == WM_TAKE_FOCUS) {
 				c->icccm_props.take_focus = true;
@@ -771,7 +868,9 @@ void initialize_client(node_t *n)
 		xcb_icccm_get_wm_protocols_reply_wipe(&protos);
 	}
 	xcb_ewmh_get_atoms_reply_t wm_state;
-	if (xcb_ewmh_get_wm_state_reply(ewmh, xcb_ewmh_get_wm_state(ewmh, win), &wm_state, NULL) == 1) {
+	ok = xcb_ewmh_get_wm_state_reply(ewmh, wp->wm_state, &wm_state, NULL);
+	wp->wm_state.sequence = 0;
+	if (ok == 1) {
 		for (unsigned int i = 0; i < wm_state.atoms_len && i < MAX_WM_STATES; i++) {
 #define HANDLE_WM_STATE(s) \
 			if (wm_state.atoms[i] == ewmh->_NET_WM_STATE_##s) { \
@@ -794,11 +893,13 @@ void initialize_client(node_t *n)
 		xcb_ewmh_get_atoms_reply_wipe(&wm_state);
 	}
 	xcb_icccm_wm_hints_t hints;
-	if (xcb_icccm_get_wm_hints_reply(dpy, xcb_icccm_get_wm_hints(dpy, win), &hints, NULL) == 1
-		&& (hints.flags & XCB_ICCCM_WM_HINT_INPUT)) {
+	ok = xcb_icccm_get_wm_hints_reply(dpy, wp->hints, &hints, NULL);
+	wp->hints.sequence = 0;
+	if (ok == 1 && (hints.flags & XCB_ICCCM_WM_HINT_INPUT)) {
 		c->icccm_props.input_hint = hints.input;
 	}
-	xcb_icccm_get_wm_normal_hints_reply(dpy, xcb_icccm_get_wm_normal_hints(dpy, win), &c->size_hints, NULL);
+	xcb_icccm_get_wm_normal_hints_reply(dpy, wp->normal_hints, &c->size_hints, NULL);
+	wp->normal_hints.sequence = 0;
 }
 
 bool is_focusable(node_t *n)
@@ -1433,6 +1534,11 @@ void remove_node(monitor_t *m, desktop_t *d, node_t *n)
 		m->sticky_count -= sticky_count(n);
 	}
 	clients_count -= clients_count_in(n);
+	for (node_t *f = first_extrema(n); f != NULL; f = next_leaf(f, n)) {
+		if (f->client != NULL) {
+			ewmh_remove_client(f->id);
+		}
+	}
 	if (is_descendant(grabbed_node, n)) {
 		grabbed_node = NULL;
 	}
@@ -1442,7 +1548,6 @@ void remove_node(monitor_t *m, desktop_t *d, node_t *n)
 		set_layout(m, d, LAYOUT_MONOCLE, false);
 	}
 
-	ewmh_update_client_list(false);
 	ewmh_update_client_list(true);
 
 	if (mon != NULL && d->focus == NULL) {
@@ -1462,6 +1567,7 @@ void free_node(node_t *n)
 	node_t *first_child = n->first_child;
 	node_t *second_child = n->second_child;
 	free(n->client);
+	free(n->presel);
 	free(n);
 	free_node(first_child);
 	free_node(second_child);
@@ -1533,6 +1639,9 @@ bool swap_nodes(monitor_t *m1, desktop_t *d1, node_t *n1, monitor_t *m2, desktop
 		ewmh_set_wm_desktop(n1, d2);
 		ewmh_set_wm_desktop(n2, d1);
 
+		reparent_node(d2, n1);
+		reparent_node(d1, n2);
+
 		history_remove(d1, n1, true);
 		history_remove(d2, n2, true);
 
@@ -1642,6 +1751,7 @@ bool transfer_node(monitor_t *ms, desktop_t *ds, node_t *ns, monitor_t *md, desk
 
 	if (ds != dd) {
 		ewmh_set_wm_desktop(ns, dd);
+		reparent_node(dd, ns);
 		if (sticky_still) {
 			if (ds == ms->desk && dd != md->desk) {
 				hide_node(ds, ns);
@@ -2084,7 +2194,12 @@ void set_hidden_local(monitor_t *m, desktop_t *d, node_t *n, bool value)
 	n->hidden = value;
 
 	if (n->client != NULL) {
-		if (n->client->shown) {
+		if (n->client->container != XCB_NONE) {
+			window_set_visibility_in(n->client->container, n->id, !value);
+			if (!n->client->shown) {
+				set_window_state(n->id, XCB_ICCCM_WM_STATE_ICONIC);
+			}
+		} else if (n->client->shown) {
 			window_set_visibility(n->id, !value);
 		}
 
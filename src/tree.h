@@ -29,6 +29,8 @@
 #define MIN_HEIGHT  32
 
 void arrange(monitor_t *m, desktop_t *d);
+void arrange_lazily(monitor_t *m, desktop_t *d);
+void arrange_subtree(monitor_t *m, desktop_t *d, node_t *n);
 void apply_layout(monitor_t *m, desktop_t *d, node_t *n, xcb_rectangle_t rect, xcb_rectangle_t root_rect);
 presel_t *make_presel(void);
 bool set_type(node_t *n, split_type_t typ);
@@ -45,9 +47,10 @@ void transfer_sticky_nodes(monitor_t *ms, desktop_t *ds, monitor_t *md, desktop_
 bool focus_node(monitor_t *m, desktop_t *d, node_t *n);
 void hide_node(desktop_t *d, node_t *n);
 void show_node(desktop_t *d, node_t *n);
+void reparent_node(desktop_t *d, node_t *n);
 node_t *make_node(uint32_t id);
 client_t *make_client(void);
-void initialize_client(node_t *n);
+void initialize_client(node_t *n, window_props_t *wp);
 bool is_focusable(node_t *n);
 bool is_leaf(node_t *n);
 bool is_first_child(node_t *n);
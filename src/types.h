@@ -25,6 +25,7 @@
 #ifndef BSPWM_TYPES_H
 #define BSPWM_TYPES_H
 #include <stdbool.h>
+#include <regex.h>
 #include <xcb/xcb.h>
 #include <xcb/xcb_icccm.h>
 #include <xcb/randr.h>
@@ -50,6 +51,11 @@ typedef enum {
 	SCHEME_SPIRAL
 } automatic_scheme_t;
 
+typedef enum {
+	DRAG_MODE_LIVE,
+	DRAG_MODE_OUTLINE
+} drag_mode_t;
+
 typedef enum {
 	STATE_TILED,
 	STATE_PSEUDO_TILED,
@@ -227,6 +233,7 @@ typedef struct {
 	xcb_size_hints_t size_hints;
 	icccm_props_t icccm_props;
 	wm_flags_t wm_flags;
+	xcb_window_t container;
 } client_t;
 
 typedef struct presel_t presel_t;
@@ -283,6 +290,8 @@ struct desktop_t {
 	padding_t padding;
 	int window_gap;
 	unsigned int border_width;
+	xcb_window_t container;
+	bool stale;
 };
 
 typedef struct monitor_t monitor_t;
@@ -310,6 +319,21 @@ typedef struct {
 	node_t *node;
 } coordinates_t;
 
+typedef struct {
+	coordinates_t loc;
+	pointer_action_t action;
+	resize_handle_t handle;
+	drag_mode_t mode;
+	xcb_rectangle_t rectangle;
+	xcb_point_t origin;
+	xcb_point_t last_position;
+	xcb_point_t position;
+	bool pending;
+	uint64_t next_frame;
+	uint64_t frames;
+	uint64_t dropped;
+} drag_t;
+
 typedef struct history_t history_t;
 struct history_t {
 	coordinates_t loc;
@@ -332,27 +356,95 @@ struct event_queue_t {
 	event_queue_t *next;
 };
 
+typedef struct queued_event_t queued_event_t;
+struct queued_event_t {
+	int mask;
+	uint32_t key;
+	char *text;
+	queued_event_t *prev;
+	queued_event_t *next;
+};
+
 typedef struct subscriber_list_t subscriber_list_t;
 struct subscriber_list_t {
 	FILE *stream;
 	char* fifo_path;
 	int field;
 	int count;
+	uint32_t monitor_id;
+	uint32_t desktop_id;
+	uint32_t node_id;
+	int coalesce;
+	unsigned int max_rate;
+	unsigned int coalesced;
+	unsigned int dropped;
+	uint64_t next_flush;
+	queued_event_t *queue_head;
+	queued_event_t *queue_tail;
+	unsigned int queue_len;
 	subscriber_list_t *prev;
 	subscriber_list_t *next;
 };
 
+typedef struct {
+	unsigned int fields;
+	unsigned int values;
+	char *monitor_desc;
+	char *desktop_desc;
+	char *node_desc;
+	direction_t split_dir;
+	double split_ratio;
+	stack_layer_t layer;
+	client_state_t state;
+	xcb_rectangle_t rect;
+} rule_delta_t;
+
+typedef enum {
+	PATTERN_ANY,
+	PATTERN_EXACT,
+	PATTERN_GLOB,
+	PATTERN_REGEX
+} pattern_kind_t;
+
+typedef struct {
+	pattern_kind_t kind;
+	regex_t regex;
+} rule_pattern_t;
+
 typedef struct rule_t rule_t;
 struct rule_t {
 	char class_name[MAXLEN];
 	char instance_name[MAXLEN];
 	char name[MAXLEN];
 	char effect[MAXLEN];
+	rule_pattern_t class_pattern;
+	rule_pattern_t instance_pattern;
+	rule_pattern_t name_pattern;
+	rule_delta_t delta;
 	bool one_shot;
+	uint64_t seq;
+	unsigned int hits;
 	rule_t *prev;
 	rule_t *next;
 };
 
+typedef struct rule_bucket_t rule_bucket_t;
+struct rule_bucket_t {
+	char *class_name;
+	char *instance_name;
+	rule_t **rules;
+	size_t len;
+	size_t size;
+	rule_bucket_t *next;
+};
+
+typedef struct {
+	rule_bucket_t **buckets;
+	size_t size;
+	size_t count;
+	uint64_t seq;
+} rule_index_t;
+
 typedef struct {
 	char class_name[MAXLEN];
 	char instance_name[MAXLEN];
@@ -377,15 +469,52 @@ typedef struct {
 	xcb_rectangle_t *rect;
 } rule_consequence_t;
 
+/* Cookies of the requests issued up front for a new window, a cookie whose
+ * reply was collected or discarded has a null sequence number. */
+typedef struct {
+	xcb_get_window_attributes_cookie_t attributes;
+	xcb_get_property_cookie_t window_type;
+	xcb_get_property_cookie_t window_state;
+	xcb_get_property_cookie_t transient_for;
+	xcb_get_property_cookie_t size_hints;
+	xcb_get_property_cookie_t class;
+	xcb_get_property_cookie_t name;
+	xcb_get_property_cookie_t strut_partial;
+	xcb_get_geometry_cookie_t geometry;
+	xcb_get_property_cookie_t protocols;
+	xcb_get_property_cookie_t wm_state;
+	xcb_get_property_cookie_t hints;
+	xcb_get_property_cookie_t normal_hints;
+} window_props_t;
+
 typedef struct pending_rule_t pending_rule_t;
 struct pending_rule_t {
 	int fd;
+	pid_t pid;
+	uint32_t request_id;
 	xcb_window_t win;
 	rule_consequence_t *csq;
+	char *buf;
+	size_t len;
+	size_t size;
+	uint64_t started;
+	uint64_t deadline;
 	event_queue_t *event_head;
 	event_queue_t *event_tail;
 	pending_rule_t *prev;
 	pending_rule_t *next;
 };
 
+typedef struct {
+	pid_t pid;
+	int in_fd;
+	int out_fd;
+	char command[MAXLEN];
+	char *buf;
+	size_t len;
+	size_t size;
+	uint32_t next_id;
+	bool answered;
+} rules_daemon_t;
+
 #endif
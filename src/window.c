@@ -27,6 +27,7 @@
 #include <stdbool.h>
 #include <string.h>
 #include <xcb/shape.h>
+#include <xcb/xcbext.h>
 #include "bspwm.h"
 #include "ewmh.h"
 #include "monitor.h"
@@ -37,15 +38,32 @@
 #include "geometry.h"
 #include "pointer.h"
 #include "stack.h"
+#include "stats.h"
+#include "trace.h"
 #include "tree.h"
 #include "parse.h"
 #include "window.h"
+#include "accounting.h"
+
+xcb_window_t presel_pool[PRESEL_POOL_SIZE];
+unsigned int presel_pool_len;
+xcb_window_t drag_outline;
 
 void schedule_window(xcb_window_t win)
+{
+	window_props_t wp = {0};
+	/* issue every request before waiting for the first reply */
+	fetch_window_props(win, &wp);
+	schedule_fetched_window(win, &wp);
+}
+
+void schedule_fetched_window(xcb_window_t win, window_props_t *wp)
 {
 	coordinates_t loc;
 	uint8_t override_redirect = 0;
-	xcb_get_window_attributes_reply_t *wa = xcb_get_window_attributes_reply(dpy, xcb_get_window_attributes(dpy, win), NULL);
+
+	xcb_get_window_attributes_reply_t *wa = xcb_get_window_attributes_reply(dpy, wp->attributes, NULL);
+	wp->attributes.sequence = 0;
 
 	if (wa != NULL) {
 		override_redirect = wa->override_redirect;
@@ -53,44 +71,100 @@ void schedule_window(xcb_window_t win)
 	}
 
 	if (override_redirect || locate_window(win, &loc)) {
+		discard_window_props(wp);
 		return;
 	}
 
 	/* ignore pending windows */
 	for (pending_rule_t *pr = pending_rule_head; pr != NULL; pr = pr->next) {
 		if (pr->win == win) {
+			discard_window_props(wp);
 			return;
 		}
 	}
 
 	rule_consequence_t *csq = make_rule_consequence();
-	apply_rules(win, csq);
-	if (!schedule_rules(win, csq)) {
-		manage_window(win, csq, -1);
+	apply_rules(win, wp, csq);
+	if (schedule_rules(win, csq)) {
+		/* the properties might change until the rule is finished */
+		discard_window_props(wp);
+	} else {
+		manage_window(win, wp, csq);
 		free(csq);
 	}
 }
 
-bool manage_window(xcb_window_t win, rule_consequence_t *csq, int fd)
+void fetch_window_props(xcb_window_t win, window_props_t *wp)
+{
+	wp->attributes = xcb_get_window_attributes(dpy, win);
+	wp->window_type = xcb_ewmh_get_wm_window_type(ewmh, win);
+	wp->window_state = xcb_ewmh_get_wm_state(ewmh, win);
+	wp->transient_for = xcb_icccm_get_wm_transient_for(dpy, win);
+	wp->size_hints = xcb_icccm_get_wm_normal_hints(dpy, win);
+	wp->class = xcb_icccm_get_wm_class(dpy, win);
+	wp->name = xcb_icccm_get_wm_name(dpy, win);
+	fetch_manage_props(win, wp);
+}
+
+void fetch_manage_props(xcb_window_t win, window_props_t *wp)
+{
+	if (!ignore_ewmh_struts) {
+		wp->strut_partial = xcb_ewmh_get_wm_strut_partial(ewmh, win);
+	}
+	wp->geometry = xcb_get_geometry(dpy, win);
+	fetch_client_props(win, wp);
+}
+
+void fetch_client_props(xcb_window_t win, window_props_t *wp)
+{
+	wp->protocols = xcb_icccm_get_wm_protocols(dpy, win, ewmh->WM_PROTOCOLS);
+	wp->wm_state = xcb_ewmh_get_wm_state(ewmh, win);
+	wp->hints = xcb_icccm_get_wm_hints(dpy, win);
+	wp->normal_hints = xcb_icccm_get_wm_normal_hints(dpy, win);
+}
+
+void discard_window_props(window_props_t *wp)
+{
+	unsigned int *sequences[] = {
+		&wp->attributes.sequence, &wp->window_type.sequence, &wp->window_state.sequence,
+		&wp->transient_for.sequence, &wp->size_hints.sequence, &wp->class.sequence,
+		&wp->name.sequence, &wp->strut_partial.sequence, &wp->geometry.sequence,
+		&wp->protocols.sequence, &wp->wm_state.sequence, &wp->hints.sequence,
+		&wp->normal_hints.sequence
+	};
+	for (unsigned int i = 0; i < LENGTH(sequences); i++) {
+		if (*sequences[i] != 0) {
+			xcb_discard_reply(dpy, *sequences[i]);
+			*sequences[i] = 0;
+		}
+	}
+}
+
+bool manage_window(xcb_window_t win, window_props_t *wp, rule_consequence_t *csq)
 {
+	uint64_t start = trace_begin();
 	monitor_t *m = mon;
 	desktop_t *d = mon->desk;
 	node_t *f = mon->desk->focus;
 
-	parse_rule_consequence(fd, csq);
-
-	if (!ignore_ewmh_struts && ewmh_handle_struts(win)) {
-		for (monitor_t *m = mon_head; m != NULL; m = m->next) {
-			for (desktop_t *d = m->desk_head; d != NULL; d = d->next) {
-				arrange(m, d);
+	if (wp->strut_partial.sequence != 0) {
+		bool changed = ewmh_handle_struts(wp->strut_partial);
+		wp->strut_partial.sequence = 0;
+		if (changed) {
+			for (monitor_t *m = mon_head; m != NULL; m = m->next) {
+				for (desktop_t *d = m->desk_head; d != NULL; d = d->next) {
+					arrange_lazily(m, d);
+				}
 			}
 		}
 	}
 
 	if (!csq->manage) {
+		discard_window_props(wp);
 		free(csq->layer);
 		free(csq->state);
 		window_show(win);
+		trace_end("manage_window", NULL, start);
 		return false;
 	}
 
@@ -138,8 +212,8 @@ bool manage_window(xcb_window_t win, rule_consequence_t *csq, int fd)
 	client_t *c = make_client();
 	c->border_width = csq->border ? d->border_width : 0;
 	n->client = c;
-	initialize_client(n);
-	initialize_floating_rectangle(n);
+	initialize_client(n, wp);
+	initialize_floating_rectangle(n, wp);
 
 	if (csq->rect != NULL) {
 		c->floating_rectangle = *csq->rect;
@@ -197,6 +271,7 @@ bool manage_window(xcb_window_t win, rule_consequence_t *csq, int fd)
 	xcb_change_window_attributes(dpy, win, XCB_CW_EVENT_MASK, values);
 	set_window_state(win, XCB_ICCCM_WM_STATE_NORMAL);
 	window_grab_buttons(win);
+	reparent_node(d, n);
 
 	if (d == m->desk) {
 		show_node(d, n);
@@ -204,7 +279,7 @@ bool manage_window(xcb_window_t win, rule_consequence_t *csq, int fd)
 		hide_node(d, n);
 	}
 
-	ewmh_update_client_list(false);
+	ewmh_add_client(win);
 	ewmh_set_wm_desktop(n, d);
 
 	if (!csq->hidden && csq->focus) {
@@ -221,6 +296,8 @@ bool manage_window(xcb_window_t win, rule_consequence_t *csq, int fd)
 	free(csq->layer);
 	free(csq->state);
 
+	trace_end("manage_window", NULL, start);
+
 	return true;
 }
 
@@ -247,6 +324,54 @@ void unmanage_window(xcb_window_t win)
 	}
 }
 
+/* The outline is a frame shaped window that ignores input, drawn above
+ * everything while a drag is in progress. */
+void initialize_drag_outline(void)
+{
+	uint32_t pxl = get_color_pixel(focused_border_color);
+	if (drag_outline == XCB_NONE) {
+		drag_outline = xcb_generate_id(dpy);
+		uint32_t mask = XCB_CW_BACK_PIXEL | XCB_CW_OVERRIDE_REDIRECT | XCB_CW_SAVE_UNDER;
+		uint32_t values[] = {pxl, 1, 1};
+		xcb_create_window(dpy, XCB_COPY_FROM_PARENT, drag_outline, root, 0, 0, 1, 1, 0, XCB_WINDOW_CLASS_INPUT_OUTPUT,
+		                  XCB_COPY_FROM_PARENT, mask, values);
+		xcb_icccm_set_wm_class(dpy, drag_outline, sizeof(DRAG_OUTLINE_IC), DRAG_OUTLINE_IC);
+		xcb_shape_rectangles(dpy, XCB_SHAPE_SO_SET, XCB_SHAPE_SK_INPUT, XCB_CLIP_ORDERING_UNSORTED, drag_outline, 0, 0, 0, NULL);
+	} else {
+		xcb_change_window_attributes(dpy, drag_outline, XCB_CW_BACK_PIXEL, &pxl);
+	}
+	uint32_t values[] = {XCB_STACK_MODE_ABOVE};
+	xcb_configure_window(dpy, drag_outline, XCB_CONFIG_WINDOW_STACK_MODE, values);
+}
+
+void draw_drag_outline(xcb_rectangle_t rect)
+{
+	uint16_t t = MAX(1, border_width);
+	if (2 * t >= rect.width || 2 * t >= rect.height) {
+		t = 1;
+	}
+	xcb_rectangle_t frame[4] = {{0, 0, rect.width, rect.height}};
+	unsigned int len = 1;
+	/* rectangles too small to be hollow are filled */
+	if (2 * t < rect.width && 2 * t < rect.height) {
+		frame[0] = (xcb_rectangle_t) {0, 0, rect.width, t};
+		frame[1] = (xcb_rectangle_t) {0, rect.height - t, rect.width, t};
+		frame[2] = (xcb_rectangle_t) {0, t, t, rect.height - 2 * t};
+		frame[3] = (xcb_rectangle_t) {rect.width - t, t, t, rect.height - 2 * t};
+		len = LENGTH(frame);
+	}
+	window_move_resize(drag_outline, rect.x, rect.y, rect.width, rect.height);
+	xcb_shape_rectangles(dpy, XCB_SHAPE_SO_SET, XCB_SHAPE_SK_BOUNDING, XCB_CLIP_ORDERING_UNSORTED, drag_outline, 0, 0, len, frame);
+	xcb_map_window(dpy, drag_outline);
+}
+
+void hide_drag_outline(void)
+{
+	if (drag_outline != XCB_NONE) {
+		xcb_unmap_window(dpy, drag_outline);
+	}
+}
+
 bool is_presel_window(xcb_window_t win)
 {
 	xcb_icccm_get_wm_class_reply_t reply;
@@ -260,23 +385,36 @@ bool is_presel_window(xcb_window_t win)
 	return ret;
 }
 
-void initialize_presel_feedback(node_t *n)
+void initialize_presel_feedback(desktop_t *d, node_t *n)
 {
 	if (n == NULL || n->presel == NULL || n->presel->feedback != XCB_NONE) {
 		return;
 	}
 
-	xcb_window_t win = xcb_generate_id(dpy);
-	uint32_t mask = XCB_CW_BACK_PIXEL | XCB_CW_SAVE_UNDER;
-	uint32_t values[] = {get_color_pixel(presel_feedback_color), 1};
-	xcb_create_window(dpy, XCB_COPY_FROM_PARENT, win, root, 0, 0, 1, 1, 0, XCB_WINDOW_CLASS_INPUT_OUTPUT,
-			          XCB_COPY_FROM_PARENT, mask, values);
+	xcb_window_t win;
+
+	if (presel_pool_len > 0) {
+		win = presel_pool[--presel_pool_len];
+		uint32_t pxl = get_color_pixel(presel_feedback_color);
+		xcb_change_window_attributes(dpy, win, XCB_CW_BACK_PIXEL, &pxl);
+	} else {
+		win = xcb_generate_id(dpy);
+		uint32_t mask = XCB_CW_BACK_PIXEL | XCB_CW_SAVE_UNDER;
+		uint32_t values[] = {get_color_pixel(presel_feedback_color), 1};
+		xcb_create_window(dpy, XCB_COPY_FROM_PARENT, win, root, 0, 0, 1, 1, 0, XCB_WINDOW_CLASS_INPUT_OUTPUT,
+		                  XCB_COPY_FROM_PARENT, mask, values);
+
+		xcb_icccm_set_wm_class(dpy, win, sizeof(PRESEL_FEEDBACK_IC), PRESEL_FEEDBACK_IC);
+		/* Make presel window's input shape NULL to pass any input to window below */
+		xcb_shape_rectangles(dpy, XCB_SHAPE_SO_SET, XCB_SHAPE_SK_INPUT, XCB_CLIP_ORDERING_UNSORTED, win, 0, 0, 0, NULL);
+	}
+
+	if (d->container != XCB_NONE) {
+		xcb_reparent_window(dpy, win, d->container, 0, 0);
+	}
 
-	xcb_icccm_set_wm_class(dpy, win, sizeof(PRESEL_FEEDBACK_IC), PRESEL_FEEDBACK_IC);
-	/* Make presel window's input shape NULL to pass any input to window below */
-	xcb_shape_rectangles(dpy, XCB_SHAPE_SO_SET, XCB_SHAPE_SK_INPUT, XCB_CLIP_ORDERING_UNSORTED, win, 0, 0, 0, NULL);
 	stacking_list_t *s = stack_tail;
-	while (s != NULL && !IS_TILED(s->node->client)) {
+	while (s != NULL && (!IS_TILED(s->node->client) || s->node->client->container != d->container)) {
 		s = s->prev;
 	}
 	if (s != NULL) {
@@ -285,6 +423,24 @@ void initialize_presel_feedback(node_t *n)
 	n->presel->feedback = win;
 }
 
+/* Unused feedback windows are unmapped and kept for the next preselections,
+ * stripped of the event mask and button grabs they were given since. */
+void release_presel_feedback(xcb_window_t win)
+{
+	if (presel_pool_len == PRESEL_POOL_SIZE) {
+		xcb_destroy_window(dpy, win);
+		return;
+	}
+	uint32_t mask = XCB_EVENT_MASK_NO_EVENT;
+	window_hide(win);
+	if (desktop_containers) {
+		xcb_reparent_window(dpy, win, root, 0, 0);
+	}
+	xcb_change_window_attributes(dpy, win, XCB_CW_EVENT_MASK, &mask);
+	xcb_ungrab_button(dpy, XCB_BUTTON_INDEX_ANY, win, XCB_MOD_MASK_ANY);
+	presel_pool[presel_pool_len++] = win;
+}
+
 void draw_presel_feedback(monitor_t *m, desktop_t *d, node_t *n)
 {
 	if (n == NULL || n->presel == NULL || d->user_layout == LAYOUT_MONOCLE || !presel_feedback) {
@@ -293,7 +449,7 @@ void draw_presel_feedback(monitor_t *m, desktop_t *d, node_t *n)
 
 	bool exists = (n->presel->feedback != XCB_NONE);
 	if (!exists) {
-		initialize_presel_feedback(n);
+		initialize_presel_feedback(d, n);
 	}
 
 	int gap = gapless_monocle && d->layout == LAYOUT_MONOCLE ? 0 : d->window_gap;
@@ -324,7 +480,7 @@ void draw_presel_feedback(monitor_t *m, desktop_t *d, node_t *n)
 	window_move_resize(p->feedback, n->rectangle.x + presel_rect.x, n->rectangle.y + presel_rect.y,
 	                   presel_rect.width, presel_rect.height);
 
-	if (!exists && m->desk == d) {
+	if (!exists && (m->desk == d || d->container != XCB_NONE)) {
 		window_show(p->feedback);
 	}
 }
@@ -421,8 +577,12 @@ void window_draw_border(xcb_window_t win, uint32_t border_color_pxl)
 	xcb_change_window_attributes(dpy, win, XCB_CW_BORDER_PIXEL, &border_color_pxl);
 }
 
+/* The orphans are fetched in two batches of requests: their desktops, then
+ * the properties of those who have one. The desktops are arranged once all of
+ * them are managed. */
 void adopt_orphans(void)
 {
+	uint64_t start = get_time_ns();
 	xcb_query_tree_reply_t *qtr = xcb_query_tree_reply(dpy, xcb_query_tree(dpy, root), NULL);
 	if (qtr == NULL) {
 		return;
@@ -430,15 +590,49 @@ void adopt_orphans(void)
 
 	int len = xcb_query_tree_children_length(qtr);
 	xcb_window_t *wins = xcb_query_tree_children(qtr);
+	xcb_get_property_cookie_t *cookies = malloc(len * sizeof(xcb_get_property_cookie_t));
+	window_props_t *props = calloc(len, sizeof(window_props_t));
+
+	if (len > 0 && (cookies == NULL || props == NULL)) {
+		free(cookies);
+		free(props);
+		free(qtr);
+		return;
+	}
+
+	for (int i = 0; i < len; i++) {
+		cookies[i] = xcb_ewmh_get_wm_desktop(ewmh, wins[i]);
+	}
 
 	for (int i = 0; i < len; i++) {
 		uint32_t idx;
-		xcb_window_t win = wins[i];
-		if (xcb_ewmh_get_wm_desktop_reply(ewmh, xcb_ewmh_get_wm_desktop(ewmh, win), &idx, NULL) == 1) {
-			schedule_window(win);
+		if (xcb_ewmh_get_wm_desktop_reply(ewmh, cookies[i], &idx, NULL) == 1) {
+			fetch_window_props(wins[i], &props[i]);
 		}
 	}
 
+	uint32_t count = clients_count;
+	batch_updates = true;
+
+	for (int i = 0; i < len; i++) {
+		if (props[i].attributes.sequence != 0) {
+			schedule_fetched_window(wins[i], &props[i]);
+		}
+	}
+
+	batch_updates = false;
+
+	for (monitor_t *m = mon_head; m != NULL; m = m->next) {
+		for (desktop_t *d = m->desk_head; d != NULL; d = d->next) {
+			arrange(m, d);
+		}
+	}
+
+	adoption_count = clients_count - count;
+	adoption_duration = (get_time_ns() - start) / 1000;
+
+	free(cookies);
+	free(props);
 	free(qtr);
 }
 
@@ -453,11 +647,12 @@ uint32_t get_border_color(bool focused_node, bool focused_monitor)
 	}
 }
 
-void initialize_floating_rectangle(node_t *n)
+void initialize_floating_rectangle(node_t *n, window_props_t *wp)
 {
 	client_t *c = n->client;
 
-	xcb_get_geometry_reply_t *geo = xcb_get_geometry_reply(dpy, xcb_get_geometry(dpy, n->id), NULL);
+	xcb_get_geometry_reply_t *geo = xcb_get_geometry_reply(dpy, wp->geometry, NULL);
+	wp->geometry.sequence = 0;
 
 	if (geo != NULL) {
 		c->floating_rectangle = (xcb_rectangle_t) {geo->x, geo->y, geo->width, geo->height};
@@ -466,13 +661,15 @@ void initialize_floating_rectangle(node_t *n)
 	free(geo);
 }
 
-xcb_rectangle_t get_window_rectangle(node_t *n)
+xcb_rectangle_t get_window_rectangle(node_t *n, uint32_t *bw)
 {
 	client_t *c = n->client;
+	*bw = UINT32_MAX;
 	if (c != NULL) {
 		xcb_get_geometry_reply_t *g = xcb_get_geometry_reply(dpy, xcb_get_geometry(dpy, n->id), NULL);
 		if (g != NULL) {
 			xcb_rectangle_t rect = (xcb_rectangle_t) {g->x, g->y, g->width, g->height};
+			*bw = g->border_width;
 			free(g);
 			return rect;
 		}
@@ -588,7 +785,21 @@ bool resize_client(coordinates_t *loc, resize_handle_t rh, int dx, int dy, bool
 		}
 		node_t *target_fence = horizontal_fence != NULL ? horizontal_fence : vertical_fence;
 		adjust_ratios(target_fence, target_fence->rectangle);
-		arrange(loc->monitor, loc->desktop);
+		/* only the subtrees of the fences can change */
+		if (vertical_fence != NULL && horizontal_fence != NULL) {
+			if (is_descendant(vertical_fence, horizontal_fence)) {
+				vertical_fence = NULL;
+			} else if (is_descendant(horizontal_fence, vertical_fence)) {
+				horizontal_fence = NULL;
+			}
+		}
+		if (horizontal_fence != NULL) {
+			arrange_subtree(loc->monitor, loc->desktop, horizontal_fence);
+		}
+		if (vertical_fence != NULL) {
+			arrange_subtree(loc->monitor, loc->desktop, vertical_fence);
+		}
+		resize_steps++;
 	} else {
 		int w = width, h = height;
 		if (relative) {
@@ -730,6 +941,18 @@ void query_pointer(xcb_window_t *win, xcb_point_t *pt)
 
 	xcb_query_pointer_reply_t *qpr = xcb_query_pointer_reply(dpy, xcb_query_pointer(dpy, root), NULL);
 
+	if (qpr != NULL && qpr->child != XCB_NONE && desktop_containers) {
+		/* The child of the root is a desktop container: look one level deeper */
+		for (monitor_t *m = mon_head; m != NULL; m = m->next) {
+			if (m->desk != NULL && m->desk->container == qpr->child) {
+				xcb_query_pointer_reply_t *cqpr = xcb_query_pointer_reply(dpy, xcb_query_pointer(dpy, qpr->child), NULL);
+				qpr->child = (cqpr != NULL ? cqpr->child : XCB_NONE);
+				free(cqpr);
+				break;
+			}
+		}
+	}
+
 	if (qpr != NULL) {
 		if (win != NULL) {
 			if (qpr->child == XCB_NONE) {
@@ -773,44 +996,125 @@ void query_pointer(xcb_window_t *win, xcb_point_t *pt)
 	}
 }
 
+/* Returns the node under the given point according to our own stacking
+ * order, unmanaged windows are ignored. */
+node_t *node_from_point(xcb_point_t pt)
+{
+	for (stacking_list_t *s = stack_tail; s != NULL; s = s->prev) {
+		if (!s->node->client->shown || s->node->hidden) {
+			continue;
+		}
+		xcb_rectangle_t rect = get_rectangle(NULL, NULL, s->node);
+		if (s->node->client->state != STATE_FULLSCREEN) {
+			rect.width += 2 * s->node->client->border_width;
+			rect.height += 2 * s->node->client->border_width;
+		}
+		if (is_inside(pt, rect)) {
+			return s->node;
+		}
+	}
+	monitor_t *m = monitor_from_point(pt);
+	if (m != NULL) {
+		desktop_t *d = m->desk;
+		for (node_t *n = first_extrema(d->root); n != NULL; n = next_leaf(n, d->root)) {
+			if (n->client == NULL && is_inside(pt, get_rectangle(m, d, n))) {
+				return n;
+			}
+		}
+	}
+	return NULL;
+}
+
+/* The pointer position is requested without waiting for the reply, which is
+ * collected by `poll_motion_recorder` before the next wait for events. */
 void update_motion_recorder(void)
 {
-	xcb_point_t pt;
-	xcb_window_t win = XCB_NONE;
-	query_pointer(&win, &pt);
-	if (win == XCB_NONE) {
+	if (motion_recorder.query.sequence == 0) {
+		motion_recorder.query = xcb_query_pointer(dpy, root);
+	}
+}
+
+void poll_motion_recorder(void)
+{
+	if (motion_recorder.query.sequence == 0) {
+		return;
+	}
+	xcb_query_pointer_reply_t *qpr = NULL;
+	if (xcb_poll_for_reply(dpy, motion_recorder.query.sequence, (void **) &qpr, NULL) == 0) {
 		return;
 	}
+	motion_recorder.query.sequence = 0;
+	pointer_round_trips_saved++;
+	if (qpr != NULL) {
+		update_motion_recorder_at((xcb_point_t) {qpr->root_x, qpr->root_y});
+		free(qpr);
+	}
+}
+
+void update_motion_recorder_at(xcb_point_t pt)
+{
 	monitor_t *m = monitor_from_point(pt);
 	if (m == NULL) {
 		return;
 	}
-	desktop_t *d = m->desk;
-	node_t *n = NULL;
-	for (n = first_extrema(d->root); n != NULL; n = next_leaf(n, d->root)) {
-		if (n->id == win || (n->presel != NULL && n->presel->feedback == win)) {
-			break;
+	node_t *n = node_from_point(pt);
+	if (n == NULL) {
+		if (m != mon) {
+			enable_monitor_motion_recorder(m);
+		} else {
+			disable_motion_recorder();
 		}
+		return;
 	}
-	if ((n != NULL && n != mon->desk->focus) || (n == NULL && m != mon)) {
-		enable_motion_recorder(win);
+	bool local = false;
+	for (node_t *f = first_extrema(m->desk->root); f != NULL && !local; f = next_leaf(f, m->desk->root)) {
+		local = (f == n);
+	}
+	if ((local && n != mon->desk->focus) || (!local && m != mon)) {
+		enable_motion_recorder(n);
 	} else {
 		disable_motion_recorder();
 	}
 }
 
-void enable_motion_recorder(xcb_window_t win)
+void enable_motion_recorder(node_t *n)
 {
-	xcb_get_geometry_reply_t *geo = xcb_get_geometry_reply(dpy, xcb_get_geometry(dpy, win), NULL);
-	if (geo != NULL) {
-		uint16_t width = geo->width + 2 * geo->border_width;
-		uint16_t height = geo->height + 2 * geo->border_width;
-		window_move_resize(motion_recorder.id, geo->x, geo->y, width, height);
-		window_above(motion_recorder.id, win);
-		window_show(motion_recorder.id);
-		motion_recorder.enabled = true;
+	if (n->client == NULL) {
+		return;
 	}
-	free(geo);
+	xcb_rectangle_t rect = get_rectangle(NULL, NULL, n);
+	uint16_t bw = n->client->state == STATE_FULLSCREEN ? 0 : 2 * n->client->border_width;
+	xcb_window_t parent = window_parent(n->client);
+	if (parent != motion_recorder.parent) {
+		xcb_reparent_window(dpy, motion_recorder.id, parent, rect.x, rect.y);
+		motion_recorder.parent = parent;
+	}
+	window_move_resize(motion_recorder.id, rect.x, rect.y, rect.width + bw, rect.height + bw);
+	window_above(motion_recorder.id, n->id);
+	window_show(motion_recorder.id);
+	motion_recorder.enabled = true;
+	pointer_round_trips_saved++;
+}
+
+/* Covers the empty parts of an unfocused monitor: its root window, or the
+ * bottom of the container of its desktop. */
+void enable_monitor_motion_recorder(monitor_t *m)
+{
+	xcb_rectangle_t rect = m->rectangle;
+	xcb_window_t parent = (m->desk != NULL && m->desk->container != XCB_NONE) ? m->desk->container : root;
+	if (parent != motion_recorder.parent) {
+		xcb_reparent_window(dpy, motion_recorder.id, parent, rect.x, rect.y);
+		motion_recorder.parent = parent;
+	}
+	window_move_resize(motion_recorder.id, rect.x, rect.y, rect.width, rect.height);
+	if (parent == root) {
+		window_above(motion_recorder.id, m->root);
+	} else {
+		window_lower(motion_recorder.id);
+	}
+	window_show(motion_recorder.id);
+	motion_recorder.enabled = true;
+	pointer_round_trips_saved++;
 }
 
 void disable_motion_recorder(void)
@@ -894,9 +1198,15 @@ void window_lower(xcb_window_t win)
 
 void window_set_visibility(xcb_window_t win, bool visible)
 {
-	uint32_t values_off[] = {ROOT_EVENT_MASK & ~XCB_EVENT_MASK_SUBSTRUCTURE_NOTIFY};
-	uint32_t values_on[] = {ROOT_EVENT_MASK};
-	xcb_change_window_attributes(dpy, root, XCB_CW_EVENT_MASK, values_off);
+	window_set_visibility_in(root, win, visible);
+}
+
+void window_set_visibility_in(xcb_window_t parent, xcb_window_t win, bool visible)
+{
+	uint32_t mask = (parent == root ? ROOT_EVENT_MASK : CONTAINER_EVENT_MASK);
+	uint32_t values_off[] = {mask & ~XCB_EVENT_MASK_SUBSTRUCTURE_NOTIFY};
+	uint32_t values_on[] = {mask};
+	xcb_change_window_attributes(dpy, parent, XCB_CW_EVENT_MASK, values_off);
 	if (visible) {
 		set_window_state(win, XCB_ICCCM_WM_STATE_NORMAL);
 		xcb_map_window(dpy, win);
@@ -904,7 +1214,26 @@ void window_set_visibility(xcb_window_t win, bool visible)
 		xcb_unmap_window(dpy, win);
 		set_window_state(win, XCB_ICCCM_WM_STATE_ICONIC);
 	}
-	xcb_change_window_attributes(dpy, root, XCB_CW_EVENT_MASK, values_on);
+	xcb_change_window_attributes(dpy, parent, XCB_CW_EVENT_MASK, values_on);
+}
+
+void window_reparent(xcb_window_t win, xcb_window_t from, xcb_window_t to, int16_t x, int16_t y)
+{
+	/* Reparenting unmaps the window, hide the resulting unmap notify from ourselves */
+	uint32_t mask = (from == root ? ROOT_EVENT_MASK : CONTAINER_EVENT_MASK);
+	uint32_t values_off[] = {mask & ~XCB_EVENT_MASK_SUBSTRUCTURE_NOTIFY};
+	uint32_t values_on[] = {mask};
+	xcb_change_window_attributes(dpy, from, XCB_CW_EVENT_MASK, values_off);
+	xcb_reparent_window(dpy, win, to, x, y);
+	xcb_change_window_attributes(dpy, from, XCB_CW_EVENT_MASK, values_on);
+}
+
+xcb_window_t window_parent(client_t *c)
+{
+	if (c == NULL || c->container == XCB_NONE) {
+		return root;
+	}
+	return c->container;
 }
 
 void window_hide(xcb_window_t win)
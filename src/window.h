@@ -31,12 +31,27 @@
 #include <xcb/xcb_icccm.h>
 #include "types.h"
 
+#define PRESEL_POOL_SIZE  32
+
+extern xcb_window_t presel_pool[PRESEL_POOL_SIZE];
+extern unsigned int presel_pool_len;
+extern xcb_window_t drag_outline;
+
 void schedule_window(xcb_window_t win);
-bool manage_window(xcb_window_t win, rule_consequence_t *csq, int fd);
+void schedule_fetched_window(xcb_window_t win, window_props_t *wp);
+void fetch_window_props(xcb_window_t win, window_props_t *wp);
+void fetch_manage_props(xcb_window_t win, window_props_t *wp);
+void fetch_client_props(xcb_window_t win, window_props_t *wp);
+void discard_window_props(window_props_t *wp);
+bool manage_window(xcb_window_t win, window_props_t *wp, rule_consequence_t *csq);
 void set_window_state(xcb_window_t win, xcb_icccm_wm_state_t state);
 void unmanage_window(xcb_window_t win);
+void initialize_drag_outline(void);
+void draw_drag_outline(xcb_rectangle_t rect);
+void hide_drag_outline(void);
 bool is_presel_window(xcb_window_t win);
-void initialize_presel_feedback(node_t *n);
+void initialize_presel_feedback(desktop_t *d, node_t *n);
+void release_presel_feedback(xcb_window_t win);
 void draw_presel_feedback(monitor_t *m, desktop_t *d, node_t *n);
 void refresh_presel_feedbacks(monitor_t *m, desktop_t *d, node_t *n);
 void show_presel_feedbacks(monitor_t *m, desktop_t *d, node_t *n);
@@ -47,14 +62,18 @@ void draw_border(node_t *n, bool focused_node, bool focused_monitor);
 void window_draw_border(xcb_window_t win, uint32_t border_color_pxl);
 void adopt_orphans(void);
 uint32_t get_border_color(bool focused_node, bool focused_monitor);
-void initialize_floating_rectangle(node_t *n);
-xcb_rectangle_t get_window_rectangle(node_t *n);
+void initialize_floating_rectangle(node_t *n, window_props_t *wp);
+xcb_rectangle_t get_window_rectangle(node_t *n, uint32_t *bw);
 bool move_client(coordinates_t *loc, int dx, int dy);
 bool resize_client(coordinates_t *loc, resize_handle_t rh, int dx, int dy, bool relative);
 void apply_size_hints(client_t *c, uint16_t *width, uint16_t *height);
 void query_pointer(xcb_window_t *win, xcb_point_t *pt);
+node_t *node_from_point(xcb_point_t pt);
 void update_motion_recorder(void);
-void enable_motion_recorder(xcb_window_t win);
+void poll_motion_recorder(void);
+void update_motion_recorder_at(xcb_point_t pt);
+void enable_motion_recorder(node_t *n);
+void enable_monitor_motion_recorder(monitor_t *m);
 void disable_motion_recorder(void);
 void window_border_width(xcb_window_t win, uint32_t bw);
 void window_move(xcb_window_t win, int16_t x, int16_t y);
@@ -66,6 +85,9 @@ void window_above(xcb_window_t w1, xcb_window_t w2);
 void window_below(xcb_window_t w1, xcb_window_t w2);
 void window_lower(xcb_window_t win);
 void window_set_visibility(xcb_window_t win, bool visible);
+void window_set_visibility_in(xcb_window_t parent, xcb_window_t win, bool visible);
+void window_reparent(xcb_window_t win, xcb_window_t from, xcb_window_t to, int16_t x, int16_t y);
+xcb_window_t window_parent(client_t *c);
 void window_hide(xcb_window_t win);
 void window_show(xcb_window_t win);
 void update_input_focus(void);
@@ -0,0 +1,194 @@
+/* Copyright (c) 2012, Bastien Dejean
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <xcb/xcb.h>
+#include <xcb/xcbext.h>
+#include "xstub.h"
+
+char xstub_connection;
+xstub_setup_t xstub_setup;
+xcb_query_extension_reply_t xstub_extension;
+uint64_t xstub_sequence;
+uint32_t xstub_next_id;
+
+xcb_connection_t *xcb_connect(__attribute__((unused)) const char *displayname, int *screenp)
+{
+	if (screenp != NULL) {
+		*screenp = 0;
+	}
+	xstub_setup.setup = (xcb_setup_t) {
+		.status = 1,
+		.protocol_major_version = 11,
+		.resource_id_base = XSTUB_FIRST_ID,
+		.resource_id_mask = 0x1FFFFF,
+		.maximum_request_length = UINT16_MAX,
+		.roots_len = 1,
+		.min_keycode = 8,
+		.max_keycode = 255
+	};
+	xstub_setup.screen = (xcb_screen_t) {
+		.root = XSTUB_ROOT,
+		.width_in_pixels = XSTUB_SCREEN_WIDTH,
+		.height_in_pixels = XSTUB_SCREEN_HEIGHT,
+		.root_depth = 24
+	};
+	xstub_sequence = 0;
+	xstub_next_id = XSTUB_FIRST_ID;
+	return (xcb_connection_t *) &xstub_connection;
+}
+
+void xcb_disconnect(__attribute__((unused)) xcb_connection_t *c)
+{
+}
+
+int xcb_connection_has_error(__attribute__((unused)) xcb_connection_t *c)
+{
+	return 0;
+}
+
+int xcb_get_file_descriptor(__attribute__((unused)) xcb_connection_t *c)
+{
+	return -1;
+}
+
+const xcb_setup_t *xcb_get_setup(__attribute__((unused)) xcb_connection_t *c)
+{
+	return &xstub_setup.setup;
+}
+
+int xcb_flush(__attribute__((unused)) xcb_connection_t *c)
+{
+	return 1;
+}
+
+uint32_t xcb_generate_id(__attribute__((unused)) xcb_connection_t *c)
+{
+	return xstub_next_id++;
+}
+
+uint32_t xcb_get_maximum_request_length(__attribute__((unused)) xcb_connection_t *c)
+{
+	return UINT16_MAX;
+}
+
+void xcb_prefetch_maximum_request_length(__attribute__((unused)) xcb_connection_t *c)
+{
+}
+
+/* No extension is present. */
+const xcb_query_extension_reply_t *xcb_get_extension_data(__attribute__((unused)) xcb_connection_t *c, __attribute__((unused)) xcb_extension_t *ext)
+{
+	return &xstub_extension;
+}
+
+void xcb_prefetch_extension_data(__attribute__((unused)) xcb_connection_t *c, __attribute__((unused)) xcb_extension_t *ext)
+{
+}
+
+unsigned int xcb_send_request(xcb_connection_t *c, int flags, struct iovec *vector, const xcb_protocol_request_t *request)
+{
+	return xcb_send_request64(c, flags, vector, request);
+}
+
+uint64_t xcb_send_request64(__attribute__((unused)) xcb_connection_t *c, __attribute__((unused)) int flags, __attribute__((unused)) struct iovec *vector, __attribute__((unused)) const xcb_protocol_request_t *request)
+{
+	return ++xstub_sequence;
+}
+
+unsigned int xcb_send_request_with_fds(xcb_connection_t *c, int flags, struct iovec *vector, const xcb_protocol_request_t *request, unsigned int num_fds, int *fds)
+{
+	return xcb_send_request_with_fds64(c, flags, vector, request, num_fds, fds);
+}
+
+uint64_t xcb_send_request_with_fds64(xcb_connection_t *c, int flags, struct iovec *vector, const xcb_protocol_request_t *request, __attribute__((unused)) unsigned int num_fds, __attribute__((unused)) int *fds)
+{
+	return xcb_send_request64(c, flags, vector, request);
+}
+
+/* Zeroed replies are large enough for the fixed part of any reply, and
+ * their lists are empty. */
+void *xstub_reply(void)
+{
+	xcb_generic_reply_t *reply = calloc(1, XSTUB_REPLY_LEN);
+	if (reply != NULL) {
+		reply->response_type = 1;
+		reply->sequence = xstub_sequence;
+	}
+	return reply;
+}
+
+void *xcb_wait_for_reply(xcb_connection_t *c, unsigned int request, xcb_generic_error_t **e)
+{
+	return xcb_wait_for_reply64(c, request, e);
+}
+
+void *xcb_wait_for_reply64(__attribute__((unused)) xcb_connection_t *c, __attribute__((unused)) uint64_t request, xcb_generic_error_t **e)
+{
+	if (e != NULL) {
+		*e = NULL;
+	}
+	return xstub_reply();
+}
+
+int xcb_poll_for_reply(xcb_connection_t *c, unsigned int request, void **reply, xcb_generic_error_t **error)
+{
+	return xcb_poll_for_reply64(c, request, reply, error);
+}
+
+int xcb_poll_for_reply64(xcb_connection_t *c, uint64_t request, void **reply, xcb_generic_error_t **error)
+{
+	*reply = xcb_wait_for_reply64(c, request, error);
+	return 1;
+}
+
+xcb_generic_error_t *xcb_request_check(__attribute__((unused)) xcb_connection_t *c, __attribute__((unused)) xcb_void_cookie_t cookie)
+{
+	return NULL;
+}
+
+void xcb_discard_reply(__attribute__((unused)) xcb_connection_t *c, __attribute__((unused)) unsigned int sequence)
+{
+}
+
+void xcb_discard_reply64(__attribute__((unused)) xcb_connection_t *c, __attribute__((unused)) uint64_t sequence)
+{
+}
+
+xcb_generic_event_t *xcb_poll_for_event(__attribute__((unused)) xcb_connection_t *c)
+{
+	return NULL;
+}
+
+xcb_generic_event_t *xcb_poll_for_queued_event(__attribute__((unused)) xcb_connection_t *c)
+{
+	return NULL;
+}
+
+xcb_generic_event_t *xcb_wait_for_event(__attribute__((unused)) xcb_connection_t *c)
+{
+	return NULL;
+}
@@ -0,0 +1,56 @@
+/* Copyright (c) 2012, Bastien Dejean
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef BSPWM_XSTUB_H
+#define BSPWM_XSTUB_H
+
+#include <stdint.h>
+#include <xcb/xcb.h>
+
+/* A stand-in for the connection layer of libxcb, linked into `bspwm-replay`
+ * in front of the library: the protocol functions of libxcb and of its
+ * extensions send their requests through it. Requests are acknowledged
+ * without being sent, replies are zeroed and no events are ever received. */
+
+#define XSTUB_ROOT           0x100
+#define XSTUB_FIRST_ID       0x200000
+#define XSTUB_SCREEN_WIDTH   1920
+#define XSTUB_SCREEN_HEIGHT  1080
+#define XSTUB_REPLY_LEN      256
+
+typedef struct {
+	xcb_setup_t setup;
+	xcb_screen_t screen;
+} xstub_setup_t;
+
+extern char xstub_connection;
+extern xstub_setup_t xstub_setup;
+extern xcb_query_extension_reply_t xstub_extension;
+extern uint64_t xstub_sequence;
+extern uint32_t xstub_next_id;
+
+void *xstub_reply(void);
+
+#endif